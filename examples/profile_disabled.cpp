@@ -0,0 +1,44 @@
+// Checks the profiling macros without EFFORTLESS_PROFILE, also when the
+// tests are built with the CMake option of the same name.
+#ifdef EFFORTLESS_PROFILE
+#undef EFFORTLESS_PROFILE
+#endif
+
+#include "effortless/profile.hpp"
+
+#include <catch2/catch.hpp>
+#include <cstddef>
+
+#include "effortless/call_tree.hpp"
+
+using namespace effortless;
+
+namespace {
+
+int unprofiledScope(const int n) {
+  EFFORTLESS_PROFILE_SCOPE("unprofiled scope");
+  EFFORTLESS_CALL_SCOPE("unprofiled call");
+  return n + 1;
+}
+
+int unprofiledFunction(const int n) {
+  EFFORTLESS_PROFILE_FUNCTION();
+  EFFORTLESS_CALL_FUNCTION();
+  return unprofiledScope(n);
+}
+
+}  // namespace
+
+TEST_CASE("Profiler: Disabled Macros", "[profiler]") {
+  const std::size_t timers = TimerRegistry::instance().size();
+  CallTree &tree = CallTree::thread();
+  tree.reset();
+  const std::size_t nodes = tree.size();
+
+  // The macros compile to nothing, so nothing is registered or recorded.
+  int n = 0;
+  for (int i = 0; i < 10; ++i) n = unprofiledFunction(n);
+  CHECK(n == 10);
+  CHECK(TimerRegistry::instance().size() == timers);
+  CHECK(tree.size() == nodes);
+}
@@ -0,0 +1,328 @@
+#ifndef EFFORTLESS_PROFILE
+#define EFFORTLESS_PROFILE
+#endif
+
+#include "effortless/call_tree.hpp"
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "effortless/flamegraph.hpp"
+#include "effortless/logger.hpp"
+#include "effortless/profile.hpp"
+#include "effortless/timer.hpp"
+#include "effortless/trace.hpp"
+
+using namespace effortless;
+using Scalar = double;
+
+namespace {
+
+Scalar work(const int n) {
+  volatile Scalar sink = 0.0;
+  for (int i = 0; i < n; ++i) sink = sink + std::sqrt((Scalar)i);
+  return sink;
+}
+
+void leaf() {
+  EFFORTLESS_CALL_SCOPE("leaf");
+  work(10000);
+}
+
+void branch() {
+  EFFORTLESS_CALL_SCOPE("branch");
+  leaf();
+  work(10000);
+}
+
+void profiledFast() {
+  EFFORTLESS_PROFILE_FUNCTION();
+  work(1000);
+}
+
+void profiledSlow() {
+  EFFORTLESS_PROFILE_SCOPE("slow");
+  work(100000);
+}
+
+}  // namespace
+
+TEST_CASE("Profiler: Call Tree", "[profiler]") {
+  CallTree &tree = CallTree::thread();
+  tree.reset();
+
+  for (int i = 0; i < 10; ++i) {
+    EFFORTLESS_CALL_SCOPE("root");
+    branch();
+    leaf();
+  }
+
+  std::ostringstream report;
+  report << tree;
+  Logger("").debug() << report.str();
+
+  CHECK(tree.current() == CallTree::ROOT);
+  // The same leaf site appears under both of its callers.
+  REQUIRE(tree.size() == 5);
+  const CallTree::Index root = tree[CallTree::ROOT].first_child;
+  REQUIRE(root != CallTree::NONE);
+  CHECK(tree.name(root) == "root");
+  CHECK(tree.calls(root) == 10);
+
+  const CallTree::Index first = tree[root].first_child;
+  const CallTree::Index second = tree[first].next_sibling;
+  CHECK(tree.name(first) == "branch");
+  CHECK(tree.name(second) == "leaf");
+  CHECK(tree.name(tree[first].first_child) == "leaf");
+  CHECK(tree.calls(tree[first].first_child) == 10);
+
+  CHECK(tree.inclusive(root) >= tree.inclusive(first) + tree.inclusive(second));
+  CHECK(tree.exclusive(first) ==
+        Approx(tree.inclusive(first) -
+               tree.inclusive(tree[first].first_child)));
+  CHECK(tree.exclusive(root) >= 0.0);
+  CHECK(report.str().find("|-leaf") != std::string::npos);
+}
+
+TEST_CASE("Profiler: Thread Trees", "[profiler]") {
+  static constexpr int THREADS = 4;
+  const CallTree before = CallTree::merged();
+
+  // Keep the threads running while reading their trees.
+  std::mutex mutex;
+  std::condition_variable done;
+  int profiled = 0;
+  bool exit = false;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t)
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i <= t; ++i) branch();
+      std::unique_lock<std::mutex> lock(mutex);
+      ++profiled;
+      done.notify_all();
+      done.wait(lock, [&exit]() { return exit; });
+    });
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&profiled]() { return profiled == THREADS; });
+  }
+
+  // Sum the calls of the top-level branch node over all threads.
+  static const ProfileSite *branch_site = nullptr;
+  std::uint64_t calls = 0;
+  int trees = 0;
+  int last_index = -1;
+  CallTree::forEachThread([&](const CallTree &tree) {
+    CHECK(tree.threadIndex() > last_index);
+    last_index = tree.threadIndex();
+    ++trees;
+    for (CallTree::Index i = tree[CallTree::ROOT].first_child;
+         i != CallTree::NONE; i = tree[i].next_sibling) {
+      if (tree.name(i) != "branch") continue;
+      branch_site = tree[i].site;
+      calls += tree.calls(i);
+      CHECK(tree[i].min <= tree[i].max);
+    }
+  });
+  CHECK(trees >= THREADS);
+  REQUIRE(branch_site != nullptr);
+  CHECK(calls >= THREADS * (THREADS + 1) / 2);
+
+  const CallTree merged = CallTree::merged();
+  CHECK(merged.threadIndex() == -1);
+  const CallTree::Index branch_node =
+    merged.find(CallTree::ROOT, *branch_site);
+  REQUIRE(branch_node != CallTree::NONE);
+  const CallTree::Index before_node =
+    before.find(CallTree::ROOT, *branch_site);
+  const std::uint64_t calls_before =
+    before_node == CallTree::NONE ? 0 : before.calls(before_node);
+  CHECK(merged.calls(branch_node) == calls + calls_before);
+  const CallTree::Index leaf_node = merged[branch_node].first_child;
+  REQUIRE(leaf_node != CallTree::NONE);
+  CHECK(merged.calls(leaf_node) == merged.calls(branch_node));
+  CHECK(merged.inclusive(branch_node) >= merged.inclusive(leaf_node));
+
+  std::ostringstream report;
+  CallTree::printAll(report);
+  Logger("").debug() << report.str();
+  CHECK(report.str().find("Thread ") != std::string::npos);
+  CHECK(report.str().find("All threads:") != std::string::npos);
+
+  // Exited threads are merged into one tree, keeping all calls.
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    exit = true;
+  }
+  done.notify_all();
+  for (std::thread &thread : threads) thread.join();
+  int remaining = 0;
+  CallTree::forEachThread([&remaining](const CallTree &) { ++remaining; });
+  CHECK(remaining == trees - THREADS);
+
+  const CallTree exited = CallTree::exited();
+  const CallTree::Index exited_node = exited.find(CallTree::ROOT, *branch_site);
+  REQUIRE(exited_node != CallTree::NONE);
+  CHECK(exited.calls(exited_node) >= calls);
+  const CallTree after = CallTree::merged();
+  CHECK(after.calls(after.find(CallTree::ROOT, *branch_site)) ==
+        merged.calls(branch_node));
+}
+
+TEST_CASE("Profiler: Registered Scopes", "[profiler]") {
+  const std::size_t registered = TimerRegistry::instance().size();
+  for (int i = 0; i < 5; ++i) {
+    profiledFast();
+    profiledSlow();
+  }
+  CHECK(TimerRegistry::instance().size() == registered + 2);
+
+  const std::vector<const ProfileTimer *> timers =
+    TimerRegistry::instance().sorted();
+  REQUIRE(timers.size() >= 2);
+  CHECK(timers[0]->name() == "Timer slow");
+  CHECK(timers[0]->count() == 5);
+  CHECK(std::string(timers[0]->file()).find("profiler.cpp") !=
+        std::string::npos);
+  CHECK(timers[0]->line() > 0);
+
+  std::ostringstream report;
+  dumpAll(report);
+  Logger("").debug() << report.str();
+  CHECK(report.str().find("Timer slow") < report.str().find("profiledFast"));
+}
+
+TEST_CASE("Profiler: Chrome Trace", "[profiler]") {
+  static constexpr int N = 100;
+
+  Timer outer("outer");
+  Timer inner("inner \"quoted\"");
+  Timer untraced("untraced");
+  untraced.tic();
+  untraced.toc();
+
+  std::ostringstream trace;
+  Tracer::start(trace, 0.001);
+  CHECK(Tracer::active());
+
+  std::thread worker([]() {
+    Timer timer("worker");
+    for (int i = 0; i < N; ++i) {
+      const ScopedTicToc scope(timer);
+      work(100);
+    }
+  });
+  for (int i = 0; i < N; ++i) {
+    const ScopedTicToc outer_scope(outer);
+    const ScopedTicToc inner_scope(inner);
+    work(100);
+  }
+  worker.join();
+  Tracer::stop();
+  CHECK(!Tracer::active());
+
+  outer.tic();
+  outer.toc();
+
+  const std::string json = trace.str();
+  const auto count = [&json](const std::string &pattern) {
+    std::size_t n = 0;
+    for (std::size_t i = json.find(pattern); i != std::string::npos;
+         i = json.find(pattern, i + 1))
+      ++n;
+    return n;
+  };
+
+  CHECK(json.rfind("{\"traceEvents\":[", 0) == 0);
+  CHECK(json.find("],\"displayTimeUnit\":\"ns\"}") != std::string::npos);
+  CHECK(count("\"ph\":\"B\"") == 3 * N);
+  CHECK(count("\"ph\":\"E\"") == 3 * N);
+  CHECK(count("\"name\":\"Timer outer\"") == 2 * N);
+  CHECK(count("\"name\":\"Timer worker\"") == 2 * N);
+  CHECK(count("Timer inner \\\"quoted\\\"") == 2 * N);
+  CHECK(count("untraced") == 0);
+  // The buffer of the exited worker was freed after writing its events.
+  CHECK(Tracer::threads() == 1);
+}
+
+TEST_CASE("Profiler: Trace Buffers of Exited Threads", "[profiler]") {
+  std::ostringstream trace;
+  Tracer::start(trace, 1000.0);
+  const std::size_t threads = Tracer::threads();
+
+  std::thread traced([]() {
+    Timer timer("traced");
+    timer.tic();
+    timer.toc();
+  });
+  traced.join();
+  // Kept until its events are written.
+  CHECK(Tracer::threads() == threads + 1);
+  Tracer::flush();
+  CHECK(Tracer::threads() == threads);
+  CHECK(trace.str().find("Timer traced") != std::string::npos);
+
+  // Exiting after the trace stopped frees the buffer right away.
+  std::thread late([]() {
+    Timer timer("late");
+    timer.tic();
+    timer.toc();
+    Tracer::stop();
+  });
+  late.join();
+  CHECK(Tracer::threads() == threads);
+}
+
+TEST_CASE("Profiler: Flamegraph", "[profiler]") {
+  Timer root("root");
+  const NestedTimer child = root.nest("child;semicolon");
+  const NestedTimer grandchild = child->nest("grandchild");
+  for (int i = 0; i < 10; ++i) {
+    root.tic();
+    child->tic();
+    grandchild->tic();
+    work(10000);
+    grandchild->toc();
+    work(10000);
+    child->toc();
+    work(10000);
+    root.toc();
+  }
+
+  std::ostringstream folded;
+  Flamegraph::write(folded, root);
+  Logger("").debug() << folded.str();
+
+  std::istringstream lines(folded.str());
+  std::string line;
+  std::vector<std::string> stacks;
+  long long total = 0;
+  while (std::getline(lines, line)) {
+    const std::size_t space = line.rfind(' ');
+    stacks.push_back(line.substr(0, space));
+    total += std::stoll(line.substr(space + 1));
+  }
+  REQUIRE(stacks.size() == 3);
+  CHECK(stacks[0] == "Timer root");
+  CHECK(stacks[1] == "Timer root;Timer child semicolon");
+  CHECK(stacks[2] == "Timer root;Timer child semicolon;Timer grandchild");
+  CHECK((Scalar)total == Approx(1e6 * root.sum()).margin(3.0));
+
+  CallTree &tree = CallTree::thread();
+  tree.reset();
+  for (int i = 0; i < 10; ++i) {
+    EFFORTLESS_CALL_SCOPE("outer");
+    branch();
+  }
+  std::ostringstream tree_folded;
+  Flamegraph::write(tree_folded, tree);
+  Logger("").debug() << tree_folded.str();
+  CHECK(tree_folded.str().find("outer;branch;leaf ") != std::string::npos);
+  CHECK(tree_folded.str().find("outer;branch ") != std::string::npos);
+}
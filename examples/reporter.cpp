@@ -0,0 +1,161 @@
+#include "effortless/reporter.hpp"
+
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "effortless/profile.hpp"
+#include "effortless/timer.hpp"
+#include "effortless/watcher.hpp"
+
+using namespace effortless;
+using Scalar = double;
+
+static void reported() {
+  static ProfileTimer timer("reported");
+  timer.add(2e-3);
+}
+
+TEST_CASE("Reporter: Periodic Interval Reports", "[reporter]") {
+  Timer timer{"Loop"};
+  IntervalStatistic latency{"Latency"};
+  latency.enableReservoir(256);
+
+  Reporter reporter;
+  reporter.add(timer);
+  reporter.add(latency, 1000.0, "ms");
+  REQUIRE(timer.intervals() != nullptr);
+
+  for (int i = 0; i < 10; ++i) {
+    timer.add(1e-3);
+    latency << 1e-3;
+  }
+  std::vector<Reporter::Report> reports = reporter.snapshot();
+  REQUIRE(reports.size() == 2);
+  CHECK(reports[0].name == "Timer Loop");
+  CHECK(reports[0].count == 10);
+  CHECK(reports[0].mean == Approx(1.0));
+  CHECK(reports[0].p99 == Approx(1.0));
+  CHECK(reports[0].unit == "ms");
+  CHECK(reports[1].count == 10);
+  CHECK(reports[1].p99 == Approx(1.0));
+
+  // The next report only covers the samples since the last one, also if the
+  // timer was reset in between.
+  timer.reset();
+  for (int i = 0; i < 12; ++i) {
+    timer.add(3e-3);
+    latency << 2e-3;
+  }
+  reports = reporter.snapshot();
+  CHECK(reports[0].count == 12);
+  CHECK(reports[0].mean == Approx(3.0));
+  CHECK(reports[0].p99 == Approx(3.0));
+  CHECK(reports[1].count == 12);
+  CHECK(reports[1].p99 == Approx(2.0));
+  CHECK(reports[1].rate() > 0.0);
+
+  reports = reporter.snapshot();
+  CHECK(reports[0].count == 0);
+  CHECK(std::isnan(reports[0].p99));
+}
+
+TEST_CASE("Reporter: Shared Intervals", "[reporter]") {
+  IntervalStatistic latency{"Latency"};
+  Reporter reporter;
+  reporter.add(latency);
+  Watcher watcher;
+  std::vector<Scalar> counts;
+  watcher.watch(
+    latency, Watcher::Stat::Count, 0.5, 0.0,
+    [&](const Watcher::Alert &alert) { counts.push_back(alert.value); });
+
+  // The watcher and the reporter each see every sample.
+  for (int i = 0; i < 10; ++i) latency << 1.0;
+  watcher.evaluate();
+  for (int i = 0; i < 5; ++i) latency << 1.0;
+  REQUIRE(counts.size() == 1);
+  CHECK(counts[0] == 10.0);
+  CHECK(reporter.snapshot()[0].count == 15);
+}
+
+TEST_CASE("Reporter: Registered Timers", "[reporter]") {
+  reported();
+  Reporter reporter;
+  reporter.addRegistered();
+
+  // The first snapshot enables the intervals of registered timers.
+  const auto find = [](const std::vector<Reporter::Report> &reports) {
+    for (const Reporter::Report &report : reports)
+      if (report.name == "Timer reported") return report;
+    FAIL("Registered timer not reported");
+    return Reporter::Report{};
+  };
+  CHECK(find(reporter.snapshot()).count == 0);
+  for (int i = 0; i < 3; ++i) reported();
+  const Reporter::Report report = find(reporter.snapshot());
+  CHECK(report.count == 3);
+  CHECK(report.mean == Approx(2.0));
+  CHECK(report.p99 == Approx(2.0));
+}
+
+TEST_CASE("Reporter: Reused Timer Addresses", "[reporter]") {
+  Reporter reporter;
+  reporter.addRegistered();
+
+  // A timer constructed where a destroyed one lived gets a fresh entry.
+  alignas(ProfileTimer) unsigned char storage[sizeof(ProfileTimer)];
+  ProfileTimer *first = new (storage) ProfileTimer("first");
+  reporter.snapshot();
+  first->add(1e-3);
+  first->~ProfileTimer();
+  ProfileTimer *second = new (storage) ProfileTimer("second");
+  REQUIRE(first == second);
+  second->add(2e-3);
+  bool found = false;
+  for (const Reporter::Report &report : reporter.snapshot()) {
+    CHECK(report.name != "Timer first");
+    if (report.name != "Timer second") continue;
+    found = true;
+    CHECK(report.count == 0);
+  }
+  CHECK(found);
+  second->add(2e-3);
+  for (const Reporter::Report &report : reporter.snapshot())
+    if (report.name == "Timer second") CHECK(report.count == 1);
+  second->~ProfileTimer();
+}
+
+TEST_CASE("Reporter: Background Reports", "[reporter]") {
+  Timer timer{"Worker"};
+  const fs::path file =
+    fs::temp_directory_path() / "effortless_reporter_test.log";
+  {
+    Reporter background("Reporter", file);
+    background.add(timer);
+    background.start(0.01);
+    std::thread worker([&timer]() {
+      const std::chrono::steady_clock::time_point t_end =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+      while (std::chrono::steady_clock::now() < t_end) {
+        timer.tic();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        timer.toc();
+      }
+    });
+    worker.join();
+    background.stop();
+  }
+  std::ifstream ifs(file);
+  std::stringstream content;
+  content << ifs.rdbuf();
+  fs::remove(file);
+  CHECK(content.str().find("Interval report") != std::string::npos);
+  CHECK(content.str().find("Timer Worker") != std::string::npos);
+}
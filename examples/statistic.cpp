@@ -0,0 +1,407 @@
+#include "effortless/statistic.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <catch2/catch.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "effortless/change_detector.hpp"
+#include "effortless/compact_statistic.hpp"
+#include "effortless/covariance_statistic.hpp"
+#include "effortless/interval_statistic.hpp"
+#include "effortless/keyed_statistics.hpp"
+#include "effortless/reservoir.hpp"
+#include "effortless/rollup.hpp"
+
+using namespace effortless;
+using Scalar = double;
+
+static constexpr Scalar tol = 1e-6;
+
+TEST_CASE("Statistic: Compact Statistic", "[statistic]") {
+  static constexpr int N = 1000;
+
+  Statistic statistic{"Reference"};
+  CompactStatistic compact{"Compact"};
+
+  for (int i = 0; i < N; ++i) {
+    const Scalar x = std::sin((Scalar)i);
+    statistic << x;
+    compact << x;
+  }
+
+  CHECK(sizeof(CompactStatistic) == 32);
+  CHECK(compact.count() == statistic.count());
+  CHECK(compact.mean() == Approx(statistic.mean()).margin(tol));
+  CHECK(compact.std() == Approx(statistic.std()).margin(tol));
+  CHECK(compact.min() == Approx(statistic.min()).margin(tol));
+  CHECK(compact.max() == Approx(statistic.max()).margin(tol));
+
+  // Names are interned once and shared by id.
+  CHECK(CompactStatistic("Compact").nameId() == compact.nameId());
+  CHECK(compact.name() == "Compact");
+}
+
+TEST_CASE("Statistic: Statistic Array", "[statistic]") {
+  static constexpr int N = 100;
+  static constexpr size_t entities = 1000;
+
+  StatisticArray array{"Entities", entities};
+  std::vector<CompactStatistic> reference(entities);
+  std::vector<Scalar> values(entities);
+
+  for (int i = 0; i < N; ++i) {
+    for (size_t e = 0; e < entities; ++e) {
+      values[e] = (Scalar)(e % 7) + std::cos((Scalar)(i * e));
+      reference[e] << values[e];
+    }
+    array.add(values);
+  }
+
+  CompactStatistic total;
+  for (size_t e = 0; e < entities; ++e) {
+    CHECK(array.count(e) == N);
+    CHECK(array.mean(e) == Approx(reference[e].mean()).margin(tol));
+    CHECK(array[e].max() == Approx(reference[e].max()).margin(tol));
+    total.merge(reference[e]);
+  }
+
+  CHECK(array.total().count() == total.count());
+  CHECK(array.total().mean() == Approx(total.mean()).margin(tol));
+
+  // Values that do not match the entities are a caller bug.
+  values.pop_back();
+  CHECK_THROWS_AS(array.add(values), std::invalid_argument);
+  CHECK(array.count(0) == N);
+}
+
+TEST_CASE("Statistic: Keyed Statistics", "[statistic]") {
+  static constexpr int keys = 10000;
+
+  KeyedStatistics<int> stats{"Objects"};
+  for (int round = 0; round < 3; ++round)
+    for (int key = 0; key < keys; ++key) stats[key] << (Scalar)(key + round);
+
+  CHECK(stats.size() == keys);
+  REQUIRE(stats.find(42) != nullptr);
+  CHECK(stats.find(42)->count() == 3);
+  CHECK(stats.find(42)->mean() == Approx(43.0));
+  CHECK(stats.find(keys) == nullptr);
+
+  const auto top = stats.top(3, KeyedStatistics<int>::Order::Max);
+  REQUIRE(top.size() == 3);
+  CHECK(top[0].first == keys - 1);
+  CHECK(top[1].first == keys - 2);
+  CHECK(top[2].first == keys - 3);
+}
+
+TEST_CASE("Statistic: Keyed Statistics with String Keys", "[statistic]") {
+  KeyedStatistics<std::string> stats{"Messages", 2};
+
+  stats["imu"] << 1.0;
+  stats[std::string_view("odometry")] << 2.0;
+  stats["imu"] << 3.0;  // Makes "odometry" the least-recently-updated key.
+  stats[std::string("image")] << 4.0;
+
+  CHECK(stats.size() == 2);
+  CHECK(stats.evictions() == 1);
+  CHECK(stats.contains(std::string_view("imu")));
+  CHECK(stats.contains("image"));
+  CHECK_FALSE(stats.contains("odometry"));
+  CHECK(stats.find("imu")->mean() == Approx(2.0));
+
+  const auto top = stats.top(2, KeyedStatistics<std::string>::Order::Count);
+  REQUIRE(top.size() == 2);
+  CHECK(top[0].first == "imu");
+}
+
+TEST_CASE("Statistic: Higher Moments and Merging", "[statistic]") {
+  static constexpr int N = 10000;
+
+  Statistic all{"All"};
+  Statistic first{"First"};
+  Statistic second{"Second"};
+  all.enableMoments();
+  first.enableMoments();
+  second.enableMoments();
+
+  // Exponential samples from a deterministic sequence: skewness 2, kurtosis 6.
+  std::vector<Scalar> samples;
+  for (int i = 0; i < N; ++i)
+    samples.push_back(-std::log(1.0 - ((Scalar)i + 0.5) / N));
+
+  Scalar mean = 0.0;
+  for (const Scalar x : samples) mean += x / N;
+  Scalar m2 = 0.0, m3 = 0.0, m4 = 0.0;
+  for (const Scalar x : samples) {
+    const Scalar d = x - mean;
+    m2 += d * d;
+    m3 += d * d * d;
+    m4 += d * d * d * d;
+  }
+  const Scalar skewness = std::sqrt((Scalar)N) * m3 / std::pow(m2, 1.5);
+  const Scalar kurtosis = (Scalar)N * m4 / (m2 * m2) - 3.0;
+
+  for (int i = 0; i < N; ++i) {
+    all << samples[(size_t)i];
+    (i % 3 ? first : second) << samples[(size_t)i];
+  }
+  first.merge(second);
+
+  CHECK(all.skewness() == Approx(skewness).epsilon(1e-9));
+  CHECK(all.kurtosis() == Approx(kurtosis).epsilon(1e-9));
+  CHECK(first.count() == N);
+  CHECK(first.mean() == Approx(all.mean()).epsilon(1e-9));
+  CHECK(first.skewness() == Approx(skewness).epsilon(1e-9));
+  CHECK(first.kurtosis() == Approx(kurtosis).epsilon(1e-9));
+  CHECK(first.max() == Approx(all.max()));
+  CHECK(all.heavyTailed());
+
+  Statistic plain;
+  plain << 1.0;
+  CHECK_FALSE(plain.hasMoments());
+  CHECK(plain.kurtosis() == 0.0);
+
+  // Enabling moments late would miss the earlier samples, so it throws.
+  CHECK_THROWS_AS(plain.enableMoments(), std::logic_error);
+  CHECK_FALSE(plain.hasMoments());
+  IntervalStatistic late{"Late"};
+  late << 1.0;
+  CHECK_THROWS_AS(late.enableMoments(), std::logic_error);
+  plain.reset();
+  plain.enableMoments();
+  CHECK(plain.hasMoments());
+  plain << 1.0;
+  plain.enableMoments(false);
+
+  // Mixed merges keep the moments of neither side, but all other values.
+  Statistic with_moments = all;
+  plain.merge(with_moments);
+  CHECK_FALSE(plain.hasMoments());
+  CHECK(plain.count() == N + 1);
+  with_moments.merge(plain);
+  CHECK_FALSE(with_moments.hasMoments());
+  CHECK(with_moments.skewness() == 0.0);
+  CHECK(with_moments.kurtosis() == 0.0);
+  CHECK(with_moments.count() == 2 * N + 1);
+  CHECK(with_moments.mean() == Approx(all.mean()).epsilon(1e-3));
+}
+
+TEST_CASE("Statistic: Covariance", "[statistic]") {
+  static constexpr int N = 1000;
+
+  CovarianceStatistic all{"Latency vs Size"};
+  CovarianceStatistic first, second;
+  CovarianceMatrixStatistic<3> matrix;
+
+  for (int i = 0; i < N; ++i) {
+    const Scalar x = (Scalar)(i % 17);
+    const Scalar y = 2.0 * x + 1.0 + 0.1 * std::sin((Scalar)i);
+    all.add(x, y);
+    (i % 2 ? first : second).add(x, y);
+    matrix.add({x, y, -x});
+  }
+  first.merge(second);
+
+  CHECK(all.count() == N);
+  CHECK(all.slope() == Approx(2.0).epsilon(1e-2));
+  CHECK(all.intercept() == Approx(1.0).epsilon(1e-2));
+  CHECK(all.correlation() == Approx(1.0).epsilon(1e-3));
+  CHECK(first.covariance() == Approx(all.covariance()).epsilon(1e-9));
+  CHECK(first.correlation() == Approx(all.correlation()).epsilon(1e-9));
+
+  CHECK(matrix.covariance(0, 1) == Approx(all.covariance()).epsilon(1e-9));
+  CHECK(matrix.slope(0, 1) == Approx(all.slope()).epsilon(1e-9));
+  CHECK(matrix.correlation(0, 2) == Approx(-1.0).epsilon(1e-9));
+}
+
+TEST_CASE("Statistic: Reservoir Sampling", "[statistic]") {
+  static constexpr int N = 100000;
+  static constexpr size_t capacity = 2000;
+
+  Statistic statistic{"Sampled"};
+  statistic.enableReservoir(capacity);
+  Reservoir low{capacity};
+  Reservoir high{capacity};
+
+  for (int i = 0; i < N; ++i) {
+    statistic << (Scalar)i;
+    (i < N / 4 ? low : high) << (Scalar)i;
+  }
+
+  REQUIRE(statistic.reservoir() != nullptr);
+  const Reservoir &reservoir = *statistic.reservoir();
+  CHECK(reservoir.size() == capacity);
+  CHECK(reservoir.count() == N);
+  // Within 5% of the range, over four standard errors of the sampling.
+  CHECK(reservoir.quantile(0.5) == Approx(N / 2).margin(0.05 * N));
+  CHECK(reservoir.quantile(0.9) == Approx(0.9 * N).margin(0.05 * N));
+
+  // Copies get a reservoir of their own, statistics without stay without.
+  Statistic copy(statistic);
+  REQUIRE(copy.reservoir() != nullptr);
+  CHECK(copy.reservoir() != statistic.reservoir());
+  CHECK(copy.reservoir()->count() == N);
+  copy.reset();
+  CHECK(statistic.reservoir()->count() == N);
+  CHECK(Statistic(Statistic("Unsampled")).reservoir() == nullptr);
+
+  // A quarter of the merged samples should come from the first quarter.
+  low.merge(high);
+  CHECK(low.size() == capacity);
+  CHECK(low.count() == N);
+  int from_low = 0;
+  for (const Scalar x : low.samples()) from_low += x < N / 4;
+  CHECK((Scalar)from_low / capacity == Approx(0.25).margin(0.05));
+
+  // Merging keeps the configuration of the merged-into statistic...
+  Statistic plain{"Plain"};
+  plain.merge(statistic);
+  CHECK(plain.count() == N);
+  CHECK(plain.reservoir() == nullptr);
+  Statistic sampled{"Sampled"};
+  sampled.enableReservoir(capacity);
+  sampled.merge(statistic);
+  REQUIRE(sampled.reservoir() != nullptr);
+  CHECK(sampled.reservoir()->count() == N);
+
+  // ...and samples without a reservoir make quantiles unavailable until reset.
+  Statistic negative{"Negative"};
+  negative << -2.0;
+  sampled.merge(negative);
+  CHECK(sampled.count() == N + 1);
+  CHECK(sampled.min() == -2.0);
+  CHECK(sampled.reservoir() == nullptr);
+  sampled << 1.0;
+  CHECK(sampled.reservoir() == nullptr);
+  sampled.reset();
+  sampled << 1.0;
+  REQUIRE(sampled.reservoir() != nullptr);
+  CHECK(sampled.reservoir()->size() == 1);
+
+  Statistic empty{"Empty"};
+  empty.merge(negative);
+  CHECK(empty.min() == -2.0);
+  CHECK(empty.count() == 1);
+
+  std::ostringstream csv;
+  reservoir.writeCsv(csv, "sample");
+  const std::string lines = csv.str();
+  CHECK(std::count(lines.begin(), lines.end(), '\n') == capacity + 1);
+}
+
+TEST_CASE("Statistic: Interval Snapshots", "[statistic]") {
+  static constexpr int N = 1000000;
+
+  Statistic statistic{"Rotating"};
+  for (int i = 0; i < 10; ++i) statistic << (Scalar)i;
+  const Statistic snapshot = statistic.snapshotAndRotate();
+  CHECK(snapshot.count() == 10);
+  CHECK(snapshot.name() == "Rotating");
+  CHECK(statistic.count() == 0);
+
+  IntervalStatistic interval{"Interval"};
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    for (int i = 1; i <= N; ++i) interval << (Scalar)i;
+    done = true;
+  });
+
+  // Rotate while the writer is running, no sample may be lost or duplicated.
+  Statistic total;
+  int intervals = 0;
+  while (!done) {
+    total.merge(interval.snapshotAndRotate().statistic);
+    ++intervals;
+  }
+  writer.join();
+  const IntervalStatistic::Interval last = interval.snapshotAndRotate();
+  total.merge(last.statistic);
+
+  CHECK(intervals > 0);
+  CHECK(total.count() == N);
+  CHECK(total.sum() == Approx(0.5 * N * (N + 1.0)).epsilon(1e-12));
+  CHECK(total.min() == 1.0);
+  CHECK(total.max() == (Scalar)N);
+  CHECK(last.seconds >= 0.0);
+}
+
+TEST_CASE("Statistic: Time Rollup", "[statistic]") {
+  using namespace std::chrono;
+
+  Rollup rollup{"Latency", {{1.0, 120}, {60.0, 60}}};
+  const Rollup::Clock::time_point t0 = Rollup::Clock::now();
+
+  // Ten minutes of samples at 10 Hz, one value per minute.
+  for (int i = 0; i < 6000; ++i)
+    rollup.add((Scalar)(i / 600), t0 + milliseconds(100 * i));
+
+  const std::vector<Rollup::Bucket> seconds = rollup.series(0);
+  const std::vector<Rollup::Bucket> minutes = rollup.series(1);
+
+  // The second level keeps only the last two minutes.
+  REQUIRE(seconds.size() == 120);
+  CHECK(seconds.back().statistic.count() > 0);
+  CHECK(seconds.back().statistic.mean() == Approx(9.0));
+  CHECK(seconds[1].time - seconds[0].time == Approx(1.0));
+
+  // Completed minutes are downsampled from seconds, the last is in progress.
+  REQUIRE(minutes.size() >= 9);
+  int total = 0;
+  for (size_t i = 0; i + 1 < minutes.size(); ++i) {
+    total += minutes[i].statistic.count();
+    CHECK(minutes[i + 1].time - minutes[i].time == Approx(60.0));
+  }
+  CHECK(total >= 5390);
+  CHECK(minutes[3].statistic.min() <= 3.0);
+  CHECK(minutes[3].statistic.max() >= 3.0);
+
+  std::ostringstream csv;
+  rollup.writeCsv(csv, 1);
+  CHECK(csv.str().rfind("time,count,mean,std,min,max\n", 0) == 0);
+}
+
+TEST_CASE("Statistic: Change Detection", "[statistic]") {
+  static constexpr int N = 2000;
+  static constexpr int change = 1200;
+
+  Statistic statistic{"Latency"};
+  std::vector<ChangeEvent> captured;
+  statistic.detectChanges(
+    {}, [&](const ChangeEvent &event) { captured.push_back(event); });
+
+  // Noisy level of 1.0 that degrades to 1.5.
+  for (int i = 0; i < N; ++i)
+    statistic << (i < change ? 1.0 : 1.5) + 0.2 * std::sin(0.7 * i);
+
+  REQUIRE(statistic.changes() != nullptr);
+  const ChangeDetector &detector = *statistic.changes();
+  CHECK(detector.changed());
+  REQUIRE(detector.events().size() == 1);
+  REQUIRE(captured.size() == 1);
+
+  const ChangeEvent &event = detector.events().front();
+  CHECK(event.start >= change - 5);
+  CHECK(event.start <= change + 5);
+  CHECK(event.detected < change + 20);
+  CHECK(event.before == Approx(1.0).margin(0.02));
+  CHECK(event.shift() == Approx(0.5).margin(0.02));
+  CHECK(captured.front().shift() > 0.0);
+
+  // Copies get a detector of their own, statistics without stay without.
+  const Statistic copy(statistic);
+  REQUIRE(copy.changes() != nullptr);
+  CHECK(copy.changes() != statistic.changes());
+  CHECK(copy.changes()->changed());
+  CHECK(Statistic(Statistic("Plain")).changes() == nullptr);
+
+  statistic.changes()->acknowledge();
+  CHECK_FALSE(statistic.changes()->changed());
+  CHECK(copy.changes()->changed());
+}
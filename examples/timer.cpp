@@ -3,8 +3,17 @@
 #include <unistd.h>
 
 #include <catch2/catch.hpp>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "effortless/logger.hpp"
+#include "effortless/profile.hpp"
 
 
 using namespace effortless;
@@ -13,6 +22,20 @@ using Scalar = double;
 static constexpr Scalar tol = 1e-2;
 static constexpr Scalar margin = 5e-4;
 
+/// Clock policy of which every third timing is not a number.
+struct InvalidEveryThirdClock {
+  using time_point = int;
+
+  static time_point now() {
+    static int ticks = 0;
+    return ++ticks;
+  }
+
+  static Scalar seconds(const time_point from, const time_point to) {
+    return to % 3 == 0 ? std::nan("") : 1e-3 * (Scalar)(to - from);
+  }
+};
+
 /// Example of Timer as unit test
 TEST_CASE("Timer: Simple Timing", "[timer]") {
   static constexpr int N = 100;
@@ -75,6 +98,142 @@ TEST_CASE("Timer: ScopedTimer", "[timer]") {
   CHECK(timer.mean() == Approx(1e-6 * dt).epsilon(tol));
 }
 
+TEST_CASE("Timer: Aggregated Scopes", "[timer]") {
+  // Capture the output, which would otherwise go to the console.
+  std::ostringstream output;
+  std::streambuf *const console = std::cout.rdbuf(output.rdbuf());
+  {
+    AggregateTimer timer("Loop Body", 10);
+    for (int i = 0; i < 25; ++i) {
+      const ScopedAggregate scope(timer);  // Prints every 10 calls...
+      usleep(10);
+    }
+    CHECK(timer.count() == 25);
+    CHECK(timer.min() >= 1e-5);
+  }  // ...and the remaining 5 calls once destroyed.
+
+  for (int i = 0; i < 3; ++i) {
+    EFFORTLESS_AGGREGATE_SCOPE("Macro");  // Prints at the end of the program.
+  }
+  std::cout.rdbuf(console);
+
+  const std::string printed = output.str();
+  std::size_t prints = 0;
+  for (std::size_t pos = printed.find("Timer Loop Body");
+       pos != std::string::npos; pos = printed.find("Timer Loop Body", pos + 1))
+    ++prints;
+  CHECK(prints == 3);
+  CHECK(printed.find("Timer Macro") == std::string::npos);
+}
+
+TEST_CASE("Timer: Thread-Local Static Timer", "[timer]") {
+  static constexpr int THREADS = 4;
+  static constexpr int CALLS = 100;
+  ThreadStaticTimer<> timer("Worker", false);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t)
+    threads.emplace_back([&timer]() {
+      for (int i = 0; i < CALLS; ++i) {
+        timer.tic();  // Each thread times into its own timer.
+        timer.toc();
+      }
+    });
+  for (std::thread &thread : threads) thread.join();
+
+  CHECK(timer.threads() == THREADS);
+  int timers = 0;
+  timer.forEachThread([&timers](const Timer &local) {
+    CHECK(local.count() == CALLS);
+    ++timers;
+  });
+  CHECK(timers == THREADS);
+
+  const Timer merged = timer.merged();
+  CHECK(merged.count() == THREADS * CALLS);
+  CHECK(merged.name() == "Timer Worker [all threads]");
+
+  // Labels follow the order of the timers when dumped.
+  std::ostringstream report;
+  timer.dump(report);
+  std::size_t position = 0;
+  for (int t = 0; t < THREADS; ++t) {
+    position = report.str().find(
+      "Worker [thread " + std::to_string(t) + "]", position);
+    CHECK(position != std::string::npos);
+  }
+  CHECK(report.str().find("Worker [all threads]") > position);
+}
+
+TEST_CASE("Timer: Thread-Local Static Timer Lifetime", "[timer]") {
+  // Prints at exit unless asked not to.
+  std::ostringstream printed;
+  std::streambuf *const cout = std::cout.rdbuf(printed.rdbuf());
+  {
+    ThreadStaticTimer<> quiet("Quiet", false);
+    quiet.tic();
+    quiet.toc();
+  }
+  CHECK(printed.str().empty());
+  {
+    ThreadStaticTimer<> loud("Loud");
+    loud.tic();
+    loud.toc();
+  }
+  std::cout.rdbuf(cout);
+  CHECK(printed.str().find("Loud [all threads]") != std::string::npos);
+
+  // A later timer reusing the slot of a destroyed one gets its own timers.
+  ThreadStaticTimer<> reused("Reused", false);
+  reused.tic();
+  reused.toc();
+  CHECK(reused.threads() == 1);
+  CHECK(reused.merged().count() == 1);
+  reused.forEachThread([](const Timer &local) {
+    CHECK(local.name() == "Timer Reused");
+  });
+}
+
+TEST_CASE("Timer: Integer Ticks", "[timer]") {
+  static constexpr int dt = 10000;
+
+  TickTimer timer("Ticks");
+  for (int i = 0; i < 5; ++i) {
+    timer.tic();
+    usleep(dt);
+    const std::uint64_t ticks = timer.toc();
+    CHECK(ticks == timer.ticks().last());
+    CHECK(timer.last() == Approx(HighResolutionClock::period() *
+                                 (Scalar)timer.ticks().last()));
+  }
+  CHECK(timer.count() == 5);
+  CHECK(timer.mean() == Approx(1e-6 * dt).margin(margin));
+  CHECK(timer.min() <= timer.mean());
+  CHECK(timer.max() >= timer.mean());
+  CHECK(timer.sum() == Approx(5 * timer.mean()));
+
+  // Large tick counts stay exact, where squares exceed 64 bits.
+  TscTickTimer exact("Exact");
+  TscTickTimer other("Other");
+  static constexpr std::uint64_t big = 1ull << 40;
+  exact.add(big);
+  exact.add(big + 2);
+  other.add(big + 4);
+  exact.merge(other);
+  CHECK(exact.count() == 3);
+  CHECK(exact.ticks().sum() == 3 * big + 6);
+  CHECK(exact.ticks().min() == big);
+  CHECK(exact.ticks().max() == big + 4);
+  CHECK(exact.ticks().mean() == Approx((Scalar)big + 2.0));
+  CHECK(exact.ticks().std() == Approx(std::sqrt(8.0 / 3.0)).epsilon(1e-3));
+  CHECK(exact.mean() == Approx(TscClock::seconds(big + 2)));
+
+  std::ostringstream report;
+  report << timer << exact;
+  CHECK(report.str().find("Timer Ticks") != std::string::npos);
+  CHECK(report.str().find("calls") != std::string::npos);
+}
+
 TEST_CASE("Timer: Nested Timing", "[timer]") {
   static constexpr int N = 100;
   static constexpr Scalar dt = 0.001;  // us
@@ -99,3 +258,316 @@ TEST_CASE("Timer: Nested Timing", "[timer]") {
   CHECK(timer_child->mean() == Approx(dt).margin(margin));
   CHECK(timer_parent.mean() == Approx(2.0 * dt).margin(margin));
 }
+
+TEST_CASE("Timer: Nested Copy and Move", "[timer]") {
+  Timer parent{"Parent"};
+  NestedTimer child = parent.nest("Child");
+  NestedTimer grandchild = child->nest("Grandchild");
+  parent.add(1.0);
+  child->add(2.0);
+  grandchild->add(3.0);
+
+  static const auto nested = [](const Timer &timer) {
+    std::vector<std::pair<std::string, int>> names;
+    timer.forEachNested([&](const Timer &nested) {
+      names.emplace_back(nested.name(), nested.count());
+      nested.forEachNested([&](const Timer &below) {
+        names.emplace_back(below.name(), below.count());
+      });
+    });
+    return names;
+  };
+  const std::vector<std::pair<std::string, int>> expected{
+    {"Timer Child", 1}, {"Timer Grandchild", 1}};
+
+  // Copies and moves of a root or nested timer keep what is nested below it.
+  const Timer copy(parent);
+  CHECK(nested(copy) == expected);
+  Timer moved_nested(std::move(*child));
+  CHECK(nested(moved_nested).size() == 1);
+  CHECK(nested(parent) == expected);
+
+  // Moving a root timer keeps handles valid, now into the new timer.
+  Timer moved(std::move(parent));
+  child->add(2.0);
+  CHECK(nested(moved)[0].second == 2);
+
+  // Assigning updates nested timers of the same name in place, so handles
+  // into the target stay valid, and adds missing ones.
+  Timer target{"Target"};
+  NestedTimer target_child = target.nest("Child");
+  NestedTimer target_other = target.nest("Other");
+  target_other->add(4.0);
+  target = copy;
+  CHECK(target.name() == "Timer Target");
+  CHECK(target.count() == 1);
+  CHECK(target_child->count() == 1);
+  CHECK(target_child->mean() == 2.0);
+  CHECK(target_other->count() == 0);
+  CHECK(nested(target).size() == 3);
+
+  // A nested target keeps its nested timers, also when moved into.
+  Timer source{"Source"};
+  source.nest("Grandchild")->add(5.0);
+  *target_child = std::move(source);
+  REQUIRE(nested(target).size() == 3);
+  CHECK(nested(target)[1].second == 1);
+  target_child->forEachNested(
+    [](const Timer &below) { CHECK(below.mean() == 5.0); });
+
+  // Assigning a timer to one nested into it copies it first.
+  *target_child = target;
+  CHECK(target_child->count() == 1);
+  CHECK(target_child->mean() == 1.0);
+}
+
+TEST_CASE("Timer: Heavy Tail Flag", "[timer]") {
+  Timer timer{"Spiky"};
+  timer.enableMoments();
+
+  for (int i = 0; i < 1000; ++i) timer.add(i % 100 ? 1e-3 : 1e-1);
+
+  std::ostringstream ss;
+  ss << timer;
+  Logger("").debug() << timer;
+
+  CHECK(timer.heavyTailed());
+  CHECK(ss.str().find("heavy tail") != std::string::npos);
+}
+
+TEST_CASE("Timer: Paired Timing", "[timer]") {
+  static constexpr int N = 20;
+
+  Timer timer{"Payload"};
+  timer.pair("payload in kB");
+
+  for (int i = 0; i < N; ++i) {
+    const int size = i % 5;
+    timer.tic();
+    usleep((useconds_t)(1000 * (1 + size)));
+    timer.toc((Scalar)size);
+  }
+
+  Logger("").debug() << timer;
+
+  REQUIRE(timer.paired() != nullptr);
+  CHECK(timer.paired()->count() == N);
+  CHECK(timer.paired()->correlation() > 0.9);
+  CHECK(timer.paired()->slope() == Approx(1e-3).margin(margin));
+
+  // Rejected timings are not paired either.
+  BasicTimer<InvalidEveryThirdClock> invalid{"Invalid"};
+  for (int i = 0; i < 9; ++i) {
+    invalid.tic();
+    invalid.toc((Scalar)i);
+  }
+  REQUIRE(invalid.paired() != nullptr);
+  CHECK(invalid.count() < 9);
+  CHECK(invalid.paired()->count() == invalid.count());
+
+  // Copies get a covariance of their own, unpaired timers stay without.
+  const BasicTimer<InvalidEveryThirdClock> copy(invalid);
+  REQUIRE(copy.paired() != nullptr);
+  CHECK(copy.paired() != invalid.paired());
+  CHECK(copy.paired()->count() == invalid.paired()->count());
+  CHECK(Timer(Timer("Unpaired")).paired() == nullptr);
+}
+
+TEST_CASE("Timer: Slowest Tagged Timings", "[timer]") {
+  static constexpr int N = 50;
+
+  Timer timer{"Requests"};
+  timer.enableExemplars(3);
+
+  for (int i = 0; i < N; ++i) {
+    timer.tic();
+    usleep(i == 7 || i == 23 ? 10000 : 100);
+    timer.toc(Tag{(std::uint64_t)i});
+  }
+
+  Logger("").debug() << timer;
+
+  REQUIRE(timer.exemplars() != nullptr);
+  const std::vector<Exemplar> slowest = timer.exemplars()->sorted();
+  REQUIRE(slowest.size() == 3);
+  CHECK(slowest[0].value == timer.max());
+  CHECK((slowest[0].tag == 7 || slowest[0].tag == 23));
+  CHECK((slowest[1].tag == 7 || slowest[1].tag == 23));
+  CHECK(slowest[0].value >= slowest[1].value);
+  CHECK(slowest[1].value >= slowest[2].value);
+}
+
+TEST_CASE("Timer: TSC Timing", "[timer]") {
+  static constexpr int N = 20;
+  static constexpr Scalar dt = 0.005;
+  static constexpr int dt_us = (int)(1e6 * dt);
+
+  const TscClock::Calibration &calibration = TscClock::calibrate();
+  CHECK(calibration.period * calibration.frequency == Approx(1.0));
+
+  TscTimer timer("TSC");
+  for (int i = 0; i < N; ++i) {
+    timer.tic();
+    usleep(dt_us);
+    timer.toc();
+  }
+
+  Logger("").debug() << timer;
+
+  CHECK(timer.count() == N);
+  CHECK(timer.min() >= dt);
+  CHECK(timer.mean() == Approx(dt).margin(5.0 * margin));
+}
+
+TEST_CASE("Timer: Clock Policies", "[timer]") {
+  static constexpr Scalar dt = 0.005;
+  static constexpr int dt_us = (int)(1e6 * dt);
+
+  BasicTimer<SteadyClock> steady("Steady");
+  BasicTimer<MonotonicRawClock> raw("MonotonicRaw");
+  BasicTimer<ThreadCpuClock> cpu("ThreadCpu");
+  BasicStaticTimer<MonotonicCoarseClock> coarse("MonotonicCoarse");
+
+  for (int i = 0; i < 4; ++i) {
+    const BasicScopedTicToc<SteadyClock> scoped_steady(steady);
+    const BasicScopedTicToc<MonotonicRawClock> scoped_raw(raw);
+    const BasicScopedTicToc<ThreadCpuClock> scoped_cpu(cpu);
+    const BasicScopedTicToc<MonotonicCoarseClock> scoped_coarse(coarse);
+    usleep(dt_us);
+  }
+
+  CHECK(steady.mean() == Approx(dt).margin(margin));
+  CHECK(raw.mean() == Approx(dt).margin(margin));
+  CHECK(coarse.mean() == Approx(dt).margin(0.01));
+  // Sleeping takes no CPU time.
+  CHECK(cpu.mean() < 0.5 * dt);
+}
+
+TEST_CASE("Timer: Static Timer Compatibility", "[timer]") {
+  static_assert(std::is_base_of_v<Timer, StaticTimer<double>>);
+  static_assert(std::is_base_of_v<Timer, StaticTimer<>>);
+  static_assert(HasNowOrdered<TscClock>::value);
+  static_assert(!HasNowOrdered<HighResolutionClock>::value);
+}
+
+TEST_CASE("Timer: CPU and Wait Time", "[timer]") {
+  static constexpr int N = 10;
+  static constexpr Scalar dt = 0.005;
+  static constexpr int dt_us = (int)(1e6 * dt);
+
+  Timer sleeping("Sleeping");
+  Timer spinning("Spinning");
+  sleeping.enableUsage();
+  spinning.enableUsage();
+
+  volatile Scalar sink = 0.0;
+  for (int i = 0; i < N; ++i) {
+    sleeping.tic();
+    usleep(dt_us);
+    sleeping.toc();
+
+    spinning.tic();
+    for (int j = 0; j < 1000000; ++j) sink = sink + std::sqrt((Scalar)j);
+    spinning.toc();
+  }
+
+  Logger("").debug() << sleeping << spinning;
+
+  REQUIRE(sleeping.usage() != nullptr);
+  REQUIRE(spinning.usage() != nullptr);
+  const Timer copy(sleeping);
+  REQUIRE(copy.usage() != nullptr);
+  CHECK(copy.usage() != sleeping.usage());
+  CHECK(copy.usage()->count() == N);
+  CHECK(Timer(Timer("Unused")).usage() == nullptr);
+  CHECK(sleeping.usage()->count() == N);
+  CHECK(sleeping.usage()->wait().mean() > 0.5 * dt);
+  CHECK(sleeping.usage()->cpu().mean() < 0.5 * dt);
+  CHECK(sleeping.usage()->total().voluntary_switches >= N);
+  CHECK(spinning.usage()->cpu().sum() > 0.5 * spinning.sum());
+}
+
+TEST_CASE("Timer: Hardware Counters", "[timer]") {
+  static constexpr int N = 10;
+
+  Timer timer("Counted");
+  const bool available = timer.enablePerfCounters();
+
+  volatile Scalar sink = 0.0;
+  for (int i = 0; i < N; ++i) {
+    timer.tic();
+    for (int j = 0; j < 100000; ++j) sink = sink + std::sqrt((Scalar)j);
+    timer.toc();
+  }
+
+  Logger("").debug() << timer;
+
+  REQUIRE(timer.perf() != nullptr);
+  // Copies get counters of their own, timers without them stay without.
+  const Timer copy(timer);
+  REQUIRE(copy.perf() != nullptr);
+  CHECK(copy.perf() != timer.perf());
+  CHECK(copy.perf()->count() == timer.perf()->count());
+  CHECK(Timer(Timer("Uncounted")).perf() == nullptr);
+  if (!available) {
+    // Without counters, e.g. in containers, timing works as usual.
+    CHECK(timer.perf()->count() == 0);
+    CHECK(timer.count() == N);
+    return;
+  }
+  CHECK(timer.perf()->count() == N);
+  CHECK(timer.perf()->ipc() > 0.0);
+  CHECK((*timer.perf())[PerfCounter::Instructions].min() > 100000);
+}
+
+TEST_CASE("Timer: Multiplexed Counter Deltas", "[timer]") {
+  PerfCounters::Reading from;
+  from.raw = {1000, 2000, 10, 5};
+  from.enabled = 100;
+  from.running = 50;
+
+  // Counting half of the interval, the delta is scaled by two.
+  PerfCounters::Reading to = from;
+  to.raw = {1500, 3000, 10, 7};
+  to.enabled = 300;
+  to.running = 150;
+  PerfCounters::Values values;
+  REQUIRE(PerfCounters::delta(from, to, values));
+  CHECK(values == PerfCounters::Values{1000, 2000, 0, 4});
+
+  // Not running in between, or going backwards, yields no interval.
+  to = from;
+  to.enabled = 200;
+  CHECK_FALSE(PerfCounters::delta(from, to, values));
+  to.running = 100;
+  to.raw[0] = 999;
+  CHECK_FALSE(PerfCounters::delta(from, to, values));
+  CHECK(values == PerfCounters::Values{});
+}
+
+TEST_CASE("Timer: Overhead Calibration", "[timer]") {
+  static constexpr int N = 1000;
+
+  const Scalar overhead = Timer::overhead();
+  CHECK(overhead > 0.0);
+  CHECK(overhead < 1e-5);
+  CHECK(TscTimer::overhead() < 1e-5);
+
+  Timer raw("Raw");
+  Timer subtracted("Subtracted");
+  subtracted.subtractOverhead();
+  for (int i = 0; i < N; ++i) {
+    raw.tic();
+    raw.toc();
+    subtracted.tic();
+    subtracted.toc();
+  }
+
+  std::ostringstream report;
+  report << raw;
+  Logger("").debug() << report.str() << subtracted;
+
+  CHECK(report.str().find("unreliable") != std::string::npos);
+  CHECK(subtracted.mean() < raw.mean());
+  CHECK(subtracted.min() >= 0.0);
+}
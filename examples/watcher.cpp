@@ -0,0 +1,144 @@
+#include "effortless/watcher.hpp"
+
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "effortless/timer.hpp"
+
+using namespace effortless;
+using Scalar = double;
+
+TEST_CASE("Watcher: Threshold with Hysteresis", "[watcher]") {
+  Timer timer{"Control Loop"};
+  Watcher watcher;
+
+  std::vector<Watcher::Alert> alerts;
+  const std::size_t id =
+    watcher.watch(timer, Watcher::Stat::Last, 2e-3, 1e-3,
+                  [&](const Watcher::Alert &alert) { alerts.push_back(alert); });
+
+  // Crossing the raise threshold alerts once...
+  for (const Scalar dt : {0.5e-3, 3e-3, 2.5e-3, 1.5e-3, 0.5e-3, 1.5e-3}) {
+    timer.add(dt);
+    watcher.evaluate();
+  }
+
+  // ...and clears only once below the clear threshold.
+  REQUIRE(alerts.size() == 2);
+  CHECK(alerts[0].raised);
+  CHECK(alerts[0].value == 3e-3);
+  CHECK_FALSE(alerts[1].raised);
+  CHECK(alerts[1].value == 0.5e-3);
+  CHECK_FALSE(watcher.raised(id));
+
+  // Statistics are not synchronized, so only the writing thread evaluates.
+  Statistic statistic{"Samples"};
+  for (int i = 0; i < 5; ++i) statistic << 1.0;
+  int background = 0;
+  const std::size_t live = watcher.watch(
+    statistic, Watcher::Stat::Count, 1.0, 0.0,
+    [&](const Watcher::Alert &) { ++background; });
+  watcher.start(1000.0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  watcher.stop();
+  CHECK(background == 0);
+  watcher.evaluate();
+  CHECK(background == 1);
+  CHECK(watcher.unwatch(live));
+
+  // Low thresholds alert when the metric drops, logging without callback.
+  watcher.watch(statistic, Watcher::Stat::Count, 10.0, 20.0);
+  watcher.evaluate();
+  CHECK(watcher.unwatch(id));
+  CHECK_FALSE(watcher.unwatch(id));
+
+  // Percentiles need a reservoir, which the intervals of timers have.
+  CHECK_THROWS_AS(watcher.watch(statistic, Watcher::Stat::P99, 1.0, 0.0),
+                  std::invalid_argument);
+  IntervalStatistic unsampled{"Unsampled"};
+  CHECK_THROWS_AS(watcher.watch(unsampled, Watcher::Stat::P50, 1.0, 0.0),
+                  std::invalid_argument);
+  statistic.enableReservoir(16);
+  CHECK(watcher.unwatch(
+    watcher.watch(statistic, Watcher::Stat::P99, 1.0, 0.0)));
+}
+
+TEST_CASE("Watcher: Timer Percentiles", "[watcher]") {
+  Timer timer{"Control Loop"};
+  Watcher watcher;
+
+  std::vector<Watcher::Alert> alerts;
+  watcher.watch(timer, Watcher::Stat::P99, 2e-3, 1e-3,
+                [&](const Watcher::Alert &alert) { alerts.push_back(alert); });
+  REQUIRE(timer.intervals() != nullptr);
+
+  // Each evaluation covers the timings since the last one.
+  for (int i = 0; i < 100; ++i) timer.add(i % 20 == 0 ? 5e-3 : 0.5e-3);
+  watcher.evaluate();
+  for (int i = 0; i < 100; ++i) timer.add(0.5e-3);
+  watcher.evaluate();
+
+  REQUIRE(alerts.size() == 2);
+  CHECK(alerts[0].raised);
+  CHECK(alerts[0].value == Approx(5e-3));
+  CHECK_FALSE(alerts[1].raised);
+  CHECK(alerts[1].value == Approx(0.5e-3));
+}
+
+TEST_CASE("Watcher: Background Evaluation of Intervals", "[watcher]") {
+  IntervalStatistic latency{"Latency"};
+  latency.enableReservoir(256);
+  Watcher watcher;
+
+  std::atomic<int> raised{0};
+  watcher.watch(latency, Watcher::Stat::P99, 1.0, 0.5,
+                [&](const Watcher::Alert &alert) { raised += alert.raised; });
+  watcher.start(200.0);
+
+  const std::chrono::steady_clock::time_point t_end =
+    std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (raised == 0 && std::chrono::steady_clock::now() < t_end) {
+    for (int i = 0; i < 100; ++i) latency << (i == 0 ? 2.0 : 0.1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  watcher.stop();
+
+  // Timing dependent, later intervals may raise again after clearing.
+  CHECK(raised >= 1);
+}
+
+TEST_CASE("Watcher: Shared Interval Snapshots", "[watcher]") {
+  IntervalStatistic latency{"Latency"};
+  Watcher watcher;
+
+  std::vector<Scalar> counts, maxima;
+  watcher.watch(
+    latency, Watcher::Stat::Count, 0.5, 0.0,
+    [&](const Watcher::Alert &alert) { counts.push_back(alert.value); });
+  watcher.watch(
+    latency, Watcher::Stat::Max, 0.5, 0.0,
+    [&](const Watcher::Alert &alert) { maxima.push_back(alert.value); });
+  const IntervalStatistic::Consumer reader = latency.subscribe();
+
+  for (int i = 0; i < 10; ++i) latency << 1.0;
+  watcher.evaluate();
+
+  // Both watches see the same full interval.
+  REQUIRE(counts.size() == 1);
+  REQUIRE(maxima.size() == 1);
+  CHECK(counts[0] == 10.0);
+  CHECK(maxima[0] == 1.0);
+
+  // Other consumers still see every sample, before and after the watcher.
+  for (int i = 0; i < 5; ++i) latency << 1.0;
+  CHECK(latency.snapshotAndRotate(reader).statistic.count() == 15);
+  for (int i = 0; i < 3; ++i) latency << 1.0;
+  watcher.evaluate();
+  CHECK(latency.snapshotAndRotate(reader).statistic.count() == 3);
+  CHECK(latency.snapshotAndRotate().statistic.count() == 18);
+  latency.unsubscribe(reader);
+}
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "effortless/compact_statistic.hpp"
+#include "effortless/tsc_clock.hpp"
+
+namespace effortless {
+
+/// A profiled scope in the source, meant to be a static object.
+struct ProfileSite {
+  ProfileSite(const std::string_view name, const char *file = "",
+              const int line = 0)
+    : name(NameTable::intern(name)), file(file), line(line) {}
+
+  NameId name;
+  const char *file;
+  int line;
+};
+
+/*
+ * Call tree of profiled scopes, built automatically per thread.
+ *
+ * Entering a `ProfileSite` descends into the child of the current node for
+ * that site, creating it on the first visit, so the same site called from
+ * different parents shows up under each of them. Each node counts its calls
+ * and accumulates its inclusive time and the time spent in its children,
+ * which gives the exclusive time.
+ *
+ * Nodes live in one contiguous arena and link to each other by index. After
+ * the first visit, entering a scope finds the child by following the sibling
+ * links, starting with the last child entered, without hashing or allocating.
+ * Times are kept in `TscClock` ticks and converted at query time.
+ *
+ * Use the tree of the calling thread from `thread()`, e.g. through
+ * `ScopedProfile`. A tree is only written by its own thread, without any
+ * synchronization. The trees of running threads can be read with
+ * `forEachThread()`. When a thread exits, its tree is merged into the tree of
+ * all exited threads, see `exited()`, and freed. `merged()` merges all of them
+ * exactly into one process-wide tree, matching nodes by their path of sites.
+ * Reading the trees of other threads is only consistent at quiescent points,
+ * like between iterations of a pipeline.
+ */
+class CallTree {
+ public:
+  using Index = std::uint32_t;
+  static constexpr Index NONE = 0xffffffff;
+  static constexpr Index ROOT = 0;
+
+  struct Node {
+    const ProfileSite *site;
+    Index parent;
+    Index first_child{NONE};
+    Index next_sibling{NONE};
+    Index last_child{NONE};
+    std::uint64_t calls{0};
+    std::uint64_t inclusive{0};
+    std::uint64_t children{0};
+    std::uint64_t min{std::numeric_limits<std::uint64_t>::max()};
+    std::uint64_t max{0};
+    std::uint64_t start{0};
+  };
+
+  CallTree(const int thread = -1) : thread_(thread) {
+    nodes_.reserve(1024);
+    nodes_.push_back({nullptr, NONE});
+  }
+
+  /// The call tree of the calling thread.
+  static CallTree &thread() {
+    thread_local const Registration registration;
+    return *registration.tree;
+  }
+
+  /// Calls `f` on the tree of each running thread that profiled, in order of
+  /// their first profiled scope.
+  template<typename F> static void forEachThread(F &&f) {
+    Registry &trees = registry();
+    const std::lock_guard<std::mutex> lock(trees.mutex);
+    for (const std::unique_ptr<CallTree> &tree : trees.trees) f(*tree);
+  }
+
+  /// The merged tree of all exited threads.
+  static CallTree exited() {
+    Registry &trees = registry();
+    const std::lock_guard<std::mutex> lock(trees.mutex);
+    return trees.exited ? *trees.exited : CallTree();
+  }
+
+  /// Merges the trees of all running and exited threads into one.
+  static CallTree merged() {
+    CallTree tree = exited();
+    forEachThread([&tree](const CallTree &thread) { tree.merge(thread); });
+    return tree;
+  }
+
+  /// Prints the tree of each running thread, of all exited threads, and the
+  /// merged tree of all threads.
+  static void printAll(std::ostream &os) {
+    forEachThread([&os](const CallTree &tree) {
+      os << "Thread " << tree.threadIndex() << ":\n" << tree;
+    });
+    const CallTree exited_threads = exited();
+    if (exited_threads.size() > 1)
+      os << "Exited threads:\n" << exited_threads;
+    os << "All threads:\n" << merged();
+  }
+
+  /// Adds the nodes of `other` to the nodes with the same path of sites.
+  CallTree &merge(const CallTree &other) {
+    std::vector<std::pair<Index, Index>> stack{{ROOT, ROOT}};
+    while (!stack.empty()) {
+      const auto [from, to] = stack.back();
+      stack.pop_back();
+      const Node &source = other.nodes_[from];
+      Node &target = nodes_[to];
+      target.calls += source.calls;
+      target.inclusive += source.inclusive;
+      target.children += source.children;
+      target.min = std::min(target.min, source.min);
+      target.max = std::max(target.max, source.max);
+      for (Index i = source.first_child; i != NONE;
+           i = other.nodes_[i].next_sibling)
+        stack.emplace_back(i, child(to, *other.nodes_[i].site));
+    }
+    return *this;
+  }
+
+  /// Index of the thread in order of registration, -1 if not a thread tree.
+  [[nodiscard]] int threadIndex() const { return thread_; }
+
+  /// Enters `site` below the current node.
+  void enter(const ProfileSite &site) {
+    current_ = child(current_, site);
+    nodes_[current_].start = TscClock::now();
+  }
+
+  /// Leaves the current node, which must have been entered.
+  void leave() {
+    const std::uint64_t now = TscClock::now();
+    Node &node = nodes_[current_];
+    const std::uint64_t ticks = now - node.start;
+    node.inclusive += ticks;
+    node.min = std::min(node.min, ticks);
+    node.max = std::max(node.max, ticks);
+    ++node.calls;
+    current_ = node.parent;
+    nodes_[current_].children += ticks;
+  }
+
+  [[nodiscard]] std::size_t size() const { return nodes_.size(); }
+  [[nodiscard]] const Node &operator[](const Index i) const {
+    return nodes_[i];
+  }
+  [[nodiscard]] Index current() const { return current_; }
+
+  [[nodiscard]] const std::string &name(const Index i) const {
+    return NameTable::name(nodes_[i].site ? nodes_[i].site->name : 0);
+  }
+
+  [[nodiscard]] std::uint64_t calls(const Index i) const {
+    return nodes_[i].calls;
+  }
+
+  /// Time spent in node `i` including its children, in seconds.
+  [[nodiscard]] Scalar inclusive(const Index i) const {
+    return TscClock::seconds(i == ROOT ? nodes_[i].children
+                                       : nodes_[i].inclusive);
+  }
+
+  /// Time spent in node `i` excluding its children, in seconds.
+  [[nodiscard]] Scalar exclusive(const Index i) const {
+    if (i == ROOT) return 0.0;
+    return TscClock::seconds(nodes_[i].inclusive - nodes_[i].children);
+  }
+
+  /// Finds the child of `parent` for `site`, NONE if not visited yet.
+  [[nodiscard]] Index find(const Index parent, const ProfileSite &site) const {
+    for (Index i = nodes_[parent].first_child; i != NONE;
+         i = nodes_[i].next_sibling)
+      if (nodes_[i].site == &site) return i;
+    return NONE;
+  }
+
+  /// Clears all nodes, must not be called inside a profiled scope.
+  void reset() {
+    nodes_.resize(1);
+    nodes_[ROOT] = {nullptr, NONE};
+    current_ = ROOT;
+  }
+
+  /// Prints the tree with inclusive and exclusive times.
+  void print(std::ostream &os) const {
+    const std::streamsize precision = os.precision(3);
+    std::vector<std::pair<Index, int>> stack{{ROOT, 0}};
+    std::vector<Index> children;
+    while (!stack.empty()) {
+      const auto [i, level] = stack.back();
+      stack.pop_back();
+      if (i != ROOT) printNode(os, i, level);
+
+      // Push the children in reverse, so they are printed in order.
+      children.clear();
+      for (Index c = nodes_[i].first_child; c != NONE;
+           c = nodes_[c].next_sibling)
+        children.push_back(c);
+      for (auto c = children.rbegin(); c != children.rend(); ++c)
+        stack.emplace_back(*c, i == ROOT ? 0 : level + 1);
+    }
+    os.precision(precision);
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const CallTree &tree) {
+    tree.print(os);
+    return os;
+  }
+
+ private:
+  /// Trees of the running threads, and the merged tree of exited threads.
+  struct Registry {
+    CallTree *add() {
+      const std::lock_guard<std::mutex> lock(mutex);
+      trees.push_back(std::make_unique<CallTree>(next_thread++));
+      return trees.back().get();
+    }
+
+    void retire(CallTree *const tree) {
+      const std::lock_guard<std::mutex> lock(mutex);
+      if (!exited) exited = std::make_unique<CallTree>();
+      exited->merge(*tree);
+      for (auto it = trees.begin(); it != trees.end(); ++it) {
+        if (it->get() != tree) continue;
+        trees.erase(it);
+        return;
+      }
+    }
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<CallTree>> trees;
+    std::unique_ptr<CallTree> exited;
+    int next_thread{0};
+  };
+
+  /// The tree of a thread, registered on first use and retired at exit.
+  struct Registration {
+    CallTree *const tree{registry().add()};
+    ~Registration() { registry().retire(tree); }
+  };
+
+  static Registry &registry() {
+    static Registry registry;
+    return registry;
+  }
+
+  Index child(const Index parent, const ProfileSite &site) {
+    Node &node = nodes_[parent];
+    if (node.last_child != NONE && nodes_[node.last_child].site == &site)
+      return node.last_child;
+
+    Index i = find(parent, site);
+    if (i == NONE) {
+      i = (Index)nodes_.size();
+      nodes_.push_back({&site, parent});
+      Index *link = &nodes_[parent].first_child;
+      while (*link != NONE) link = &nodes_[*link].next_sibling;
+      *link = i;
+    }
+    nodes_[parent].last_child = i;
+    return i;
+  }
+
+  /// Prints the line of node `i`, without its children.
+  void printNode(std::ostream &os, const Index i, const int level) const {
+    const Node &node = nodes_[i];
+    const Scalar parent = inclusive(node.parent);
+    const int name_width = 30 - 2 * level;
+    for (int l = 1; l < level; ++l) os << "| ";
+    if (level > 0) os << "|-";
+    os << std::left << std::setw(std::max(name_width, 1)) << name(i);
+    os << std::right << std::setw(8) << inclusive(i) << "s  ";
+    if (parent > 0.0)
+      os << std::setw(3) << (int)(100.0 * inclusive(i) / parent) << "% ";
+    else
+      os << std::string(5, ' ');
+    const Scalar calls = (Scalar)std::max<std::uint64_t>(node.calls, 1);
+    os << std::setw(8) << node.calls << "  calls   self: " << std::setw(8)
+       << exclusive(i) << "s  mean: " << std::setw(8)
+       << 1000 * inclusive(i) / calls << "  [min|max:  " << std::setw(8)
+       << 1000 * TscClock::seconds(node.calls ? node.min : 0) << " | "
+       << std::left << std::setw(8) << 1000 * TscClock::seconds(node.max)
+       << std::right << "] in ms\n";
+  }
+
+  std::vector<Node> nodes_;
+  Index current_{ROOT};
+  int thread_;
+};
+
+/*
+ * Profiles a scope from construction to destruction in the call tree of the
+ * calling thread, see `CallTree`.
+ */
+class ScopedProfile {
+ public:
+  ScopedProfile(const ProfileSite &site) : tree_(CallTree::thread()) {
+    tree_.enter(site);
+  }
+  ~ScopedProfile() { tree_.leave(); }
+
+  ScopedProfile(const ScopedProfile &) = delete;
+  ScopedProfile &operator=(const ScopedProfile &) = delete;
+
+ private:
+  CallTree &tree_;
+};
+
+}  // namespace effortless
+
+#ifndef EFFORTLESS_CONCAT
+#define EFFORTLESS_CONCAT_IMPL(a, b) a##b
+#define EFFORTLESS_CONCAT(a, b) EFFORTLESS_CONCAT_IMPL(a, b)
+#endif
+
+/*
+ * Profiles the enclosing scope in the call tree of the calling thread.
+ *
+ * Expands to a function-local static `ProfileSite` with the name and source
+ * location, and a `ScopedProfile` on it. Like `EFFORTLESS_PROFILE_SCOPE`,
+ * compiles to nothing unless `EFFORTLESS_PROFILE` is defined.
+ */
+#ifdef EFFORTLESS_PROFILE
+#define EFFORTLESS_CALL_SCOPE(name)                                     \
+  EFFORTLESS_CALL_SCOPE_IMPL(                                           \
+    name, EFFORTLESS_CONCAT(effortless_call_site_, __LINE__),           \
+    EFFORTLESS_CONCAT(effortless_call_scope_, __LINE__))
+#define EFFORTLESS_CALL_SCOPE_IMPL(name, site, scope)                   \
+  static const ::effortless::ProfileSite site(name, __FILE__, __LINE__); \
+  const ::effortless::ScopedProfile scope(site)
+#else
+#define EFFORTLESS_CALL_SCOPE(name) static_assert(true, "")
+#endif
+
+/// Profiles the enclosing function, see `EFFORTLESS_CALL_SCOPE`.
+#define EFFORTLESS_CALL_FUNCTION() EFFORTLESS_CALL_SCOPE(__func__)
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace effortless {
+
+using Scalar = double;
+
+struct ChangeDetectorSettings {
+  /// Samples used to learn the reference level and spread of a regime.
+  int warmup = 500;
+  /// Allowed drift per sample before evidence accumulates, in std units.
+  Scalar drift = 0.5;
+  /// Accumulated evidence that signals a change, in std units.
+  Scalar threshold = 12.0;
+  /// Samples are clipped to this many std, so outliers of heavy-tailed
+  /// streams like latencies do not raise false alarms on their own.
+  Scalar clip = 3.0;
+  /// Lower bound of the std relative to the mean, for near-constant signals.
+  Scalar min_relative_std = 1e-3;
+};
+
+/// A detected shift in the level of a stream.
+struct ChangeEvent {
+  /// Index of the first sample of the new level.
+  std::uint64_t start;
+  /// Index of the sample at which the change was detected.
+  std::uint64_t detected;
+  std::chrono::system_clock::time_point time;
+  Scalar before;
+  /// Estimated at detection, refined once the new level has been learned.
+  Scalar after;
+
+  [[nodiscard]] Scalar shift() const { return after - before; }
+};
+
+/*
+ * Online change-point detection with a two-sided CUSUM test.
+ *
+ * Learns the level and spread of the stream over a warm-up window, then
+ * accumulates evidence for upward and downward shifts of the standardized
+ * samples, costing O(1) per sample. Once the evidence exceeds the threshold, a
+ * `ChangeEvent` reports where the new level started and how much it shifted,
+ * `changed()` becomes true until acknowledged, and the optional callback is
+ * called, e.g. to capture diagnostics right when performance degrades. The
+ * detector then learns the new level and continues.
+ */
+class ChangeDetector {
+ public:
+  using Callback = std::function<void(const ChangeEvent &)>;
+
+  ChangeDetector(const ChangeDetectorSettings &settings = {},
+                 Callback callback = Callback())
+    : settings_(settings), callback_(std::move(callback)) {
+    settings_.warmup = std::max(settings_.warmup, 2);
+  }
+
+  void add(const Scalar in) {
+    if (!std::isfinite(in)) return;
+    ++n_;
+
+    if (warmup_n_ < settings_.warmup) {
+      learn(in);
+      return;
+    }
+
+    const Scalar z =
+      std::clamp((in - mean_) * inv_std_, -settings_.clip, settings_.clip);
+    const Scalar up = up_.update(z - settings_.drift, in, n_);
+    const Scalar down = down_.update(-z - settings_.drift, in, n_);
+    if (up > settings_.threshold)
+      detect(up_);
+    else if (down > settings_.threshold)
+      detect(down_);
+  }
+
+  ChangeDetector &operator<<(const Scalar in) {
+    add(in);
+    return *this;
+  }
+
+  /// True if a change was detected since the last `acknowledge()`.
+  [[nodiscard]] bool changed() const { return changed_; }
+  void acknowledge() { changed_ = false; }
+
+  [[nodiscard]] const std::vector<ChangeEvent> &events() const {
+    return events_;
+  }
+
+  /// Level of the current regime, once learned.
+  [[nodiscard]] Scalar level() const { return mean_; }
+  [[nodiscard]] std::uint64_t count() const { return n_; }
+
+  void onChange(Callback callback) { callback_ = std::move(callback); }
+
+  void reset() {
+    n_ = 0;
+    events_.clear();
+    changed_ = false;
+    restart();
+  }
+
+ private:
+  /// One-sided cumulative sum, tracking the samples since it was last zero.
+  struct Cusum {
+    Scalar s{0.0};
+    Scalar sum{0.0};
+    std::uint64_t n{0};
+    std::uint64_t start{0};
+
+    Scalar update(const Scalar evidence, const Scalar in,
+                  const std::uint64_t index) {
+      s += evidence;
+      if (s <= 0.0) {
+        s = 0.0;
+        n = 0;
+        sum = 0.0;
+        return s;
+      }
+      if (!n) start = index;
+      ++n;
+      sum += in;
+      return s;
+    }
+  };
+
+  void learn(const Scalar in) {
+    ++warmup_n_;
+    const Scalar delta = in - mean_;
+    mean_ += delta / warmup_n_;
+    m2_ += delta * (in - mean_);
+    if (warmup_n_ == settings_.warmup) {
+      const Scalar std = std::max(std::sqrt(m2_ / warmup_n_),
+                                  settings_.min_relative_std * std::abs(mean_));
+      inv_std_ = std > 0.0 ? 1.0 / std : 0.0;
+      if (!events_.empty() && events_.back().detected + warmup_n_ == n_)
+        events_.back().after = mean_;
+    }
+  }
+
+  void detect(const Cusum &cusum) {
+    const ChangeEvent event{cusum.start, n_, std::chrono::system_clock::now(),
+                            mean_, cusum.sum / (Scalar)cusum.n};
+    events_.push_back(event);
+    changed_ = true;
+    restart();
+    if (callback_) callback_(event);
+  }
+
+  void restart() {
+    warmup_n_ = 0;
+    mean_ = 0.0;
+    m2_ = 0.0;
+    inv_std_ = 0.0;
+    up_ = Cusum();
+    down_ = Cusum();
+  }
+
+  ChangeDetectorSettings settings_;
+  Callback callback_;
+
+  std::uint64_t n_{0};
+  int warmup_n_{0};
+  Scalar mean_{0.0};
+  Scalar m2_{0.0};
+  Scalar inv_std_{0.0};
+  Cusum up_;
+  Cusum down_;
+
+  bool changed_{false};
+  std::vector<ChangeEvent> events_;
+};
+
+}  // namespace effortless
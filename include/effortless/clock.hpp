@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <type_traits>
+
+#include "effortless/tsc_clock.hpp"
+
+namespace effortless {
+
+using Scalar = double;
+
+/*
+ * Clock policies for timers and throttlers.
+ *
+ * A clock policy provides a `time_point` type, a static `now()`, and a static
+ * `seconds(from, to)` converting the difference of two time points to
+ * seconds. Pick the cheapest clock adequate for a call site, e.g.
+ * `BasicTimer<MonotonicCoarseClock>` to count slow events cheaply, or
+ * `BasicTimer<TscClock>` to time short kernels.
+ *
+ * For integer timing, like `BasicTickTimer`, a policy also provides
+ * `ticks(from, to)`, the unsigned number of clock ticks between two time
+ * points, and `period()`, the seconds per tick.
+ *
+ * A policy may also provide `nowOrdered()`, a read that waits for all previous
+ * instructions, like `TscClock`. Timers stop measurements through
+ * `nowOrdered<Clock>()`, which uses it if provided and `now()` otherwise.
+ */
+
+/// Adapts a `std::chrono` clock to a clock policy.
+template<typename ChronoClock> struct ChronoClockPolicy {
+  using time_point = typename ChronoClock::time_point;
+
+  static time_point now() { return ChronoClock::now(); }
+
+  static Scalar seconds(const time_point from, const time_point to) {
+    return 1e-9 * (Scalar)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    to - from)
+                    .count();
+  }
+
+  /// Ticks between two time points, zero if the clock went backwards.
+  static std::uint64_t ticks(const time_point from, const time_point to) {
+    const auto count = (to - from).count();
+    return count > 0 ? (std::uint64_t)count : 0;
+  }
+
+  /// Seconds per tick.
+  static Scalar period() {
+    return (Scalar)ChronoClock::period::num / (Scalar)ChronoClock::period::den;
+  }
+};
+
+using SteadyClock = ChronoClockPolicy<std::chrono::steady_clock>;
+using HighResolutionClock =
+  ChronoClockPolicy<std::chrono::high_resolution_clock>;
+using SystemClock = ChronoClockPolicy<std::chrono::system_clock>;
+
+/// Clock policy reading a POSIX clock, with time points in ns.
+template<clockid_t Id> struct PosixClock {
+  using time_point = std::int64_t;
+
+  static time_point now() {
+    timespec t;
+    clock_gettime(Id, &t);
+    return (std::int64_t)t.tv_sec * 1000000000 + (std::int64_t)t.tv_nsec;
+  }
+
+  static Scalar seconds(const time_point from, const time_point to) {
+    return 1e-9 * (Scalar)(to - from);
+  }
+
+  /// Nanoseconds between two time points, zero if the clock went backwards.
+  static std::uint64_t ticks(const time_point from, const time_point to) {
+    return to > from ? (std::uint64_t)(to - from) : 0;
+  }
+
+  static Scalar period() { return 1e-9; }
+};
+
+template<typename Clock, typename = void>
+struct HasNowOrdered : std::false_type {};
+template<typename Clock>
+struct HasNowOrdered<Clock, std::void_t<decltype(Clock::nowOrdered())>>
+  : std::true_type {};
+
+/// Reads `Clock` to stop a measurement, ordered after the measured code if
+/// the clock supports it.
+template<typename Clock> typename Clock::time_point nowOrdered() {
+  if constexpr (HasNowOrdered<Clock>::value)
+    return Clock::nowOrdered();
+  else
+    return Clock::now();
+}
+
+#if defined(CLOCK_MONOTONIC_RAW)
+/// Monotonic clock not slewed by NTP, e.g. for timing across adjustments.
+using MonotonicRawClock = PosixClock<CLOCK_MONOTONIC_RAW>;
+#endif
+
+#if defined(CLOCK_MONOTONIC_COARSE)
+/// Cheapest clock, ~5 ns per read but only updated every tick (~1-4 ms).
+using MonotonicCoarseClock = PosixClock<CLOCK_MONOTONIC_COARSE>;
+#endif
+
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+/// CPU time consumed by the calling thread, excluding time spent waiting.
+using ThreadCpuClock = PosixClock<CLOCK_THREAD_CPUTIME_ID>;
+#endif
+
+}  // namespace effortless
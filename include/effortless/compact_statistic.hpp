@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace effortless {
+
+using Scalar = double;
+using NameId = std::uint32_t;
+
+/*
+ * Process-wide table of interned names.
+ *
+ * Compact statistics do not own their name, but refer to it by a small integer
+ * id. Interning the same name twice returns the same id, and the id 0 is
+ * always the empty name. Interning and lookup are thread-safe, but take a lock,
+ * so they are meant for construction and report time, not the hot path.
+ */
+class NameTable {
+ public:
+  /// Returns the id of `name`, adding it to the table if needed.
+  static NameId intern(const std::string_view name) {
+    NameTable &table = instance();
+    const std::lock_guard<std::mutex> lock(table.mutex_);
+    const auto it = table.ids_.find(name);
+    if (it != table.ids_.end()) return it->second;
+
+    const NameId id = (NameId)table.names_.size();
+    table.names_.emplace_back(name);
+    table.ids_.emplace(table.names_.back(), id);
+    return id;
+  }
+
+  /// Returns the name of an interned id. References stay valid forever.
+  static const std::string &name(const NameId id) {
+    NameTable &table = instance();
+    const std::lock_guard<std::mutex> lock(table.mutex_);
+    return id < table.names_.size() ? table.names_[id] : table.names_[0];
+  }
+
+  /// Number of interned names, including the empty name.
+  static std::size_t size() {
+    NameTable &table = instance();
+    const std::lock_guard<std::mutex> lock(table.mutex_);
+    return table.names_.size();
+  }
+
+ private:
+  NameTable() {
+    names_.emplace_back();
+    ids_.emplace(names_.back(), 0);
+  }
+
+  static NameTable &instance() {
+    static NameTable table;
+    return table;
+  }
+
+  std::mutex mutex_;
+  std::deque<std::string> names_;
+  std::unordered_map<std::string_view, NameId> ids_;
+};
+
+/*
+ * Compact statistic for large numbers of instances.
+ *
+ * Provides the same running statistics as `Statistic`, but fits into 32 bytes:
+ * the name is an interned `NameId`, the count is 32 bit and the extrema are
+ * stored in single precision. It is trivially copyable, so it can be stored
+ * inline in containers and copied without allocation.
+ */
+class CompactStatistic {
+ public:
+  CompactStatistic() = default;
+  explicit CompactStatistic(const NameId name) : name_(name) {}
+  explicit CompactStatistic(const std::string_view name)
+    : name_(NameTable::intern(name)) {}
+
+  Scalar operator<<(const Scalar in) {
+    if (!std::isfinite(in)) return std::numeric_limits<Scalar>::quiet_NaN();
+
+    ++n_;
+    sum_ += in;
+    ssum_ += in * in;
+    min_ = std::min((float)in, min_);
+    max_ = std::max((float)in, max_);
+
+    return mean();
+  }
+
+  Scalar add(const Scalar in) { return operator<<(in); }
+
+  /// Merges the samples of `rhs` into this statistic.
+  CompactStatistic &merge(const CompactStatistic &rhs) {
+    n_ += rhs.n_;
+    sum_ += rhs.sum_;
+    ssum_ += rhs.ssum_;
+    min_ = std::min(rhs.min_, min_);
+    max_ = std::max(rhs.max_, max_);
+    return *this;
+  }
+
+  CompactStatistic &operator+=(const CompactStatistic &rhs) {
+    return merge(rhs);
+  }
+
+  [[nodiscard]] int count() const { return (int)n_; }
+  [[nodiscard]] Scalar mean() const { return sum_ / ((Scalar)n_); }
+  [[nodiscard]] Scalar std() const {
+    if (!n_) return 0.0;
+    const Scalar m = mean();
+    return std::sqrt(std::max(ssum_ / n_ - m * m, 0.0));
+  }
+  [[nodiscard]] Scalar min() const { return (Scalar)min_; }
+  [[nodiscard]] Scalar max() const { return (Scalar)max_; }
+  [[nodiscard]] Scalar sum() const { return sum_; }
+  [[nodiscard]] Scalar ssum() const { return ssum_; }
+
+  [[nodiscard]] NameId nameId() const { return name_; }
+  [[nodiscard]] const std::string &name() const {
+    return NameTable::name(name_);
+  }
+
+  void reset() { *this = CompactStatistic(name_); }
+
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const CompactStatistic &s) {
+    if (s.n_ < 1) {
+      os << s.name() << " has no sample yet!" << std::endl;
+      return os;
+    }
+
+    const std::streamsize prec = os.precision();
+    os.precision(3);
+
+    os << std::left << std::setw(16) << s.name() << "mean|std  ";
+    os << std::left << std::setw(5) << s.mean() << "|";
+    os << std::left << std::setw(5) << s.std() << "  [min|max:  ";
+    os << std::left << std::setw(5) << s.min() << "|";
+    os << std::left << std::setw(5) << s.max() << "]" << std::endl;
+
+    os.precision(prec);
+    return os;
+  }
+
+ private:
+  friend class StatisticArray;
+
+  std::uint32_t n_{0};
+  NameId name_{0};
+  Scalar sum_{0.0};
+  Scalar ssum_{0.0};
+  float min_{std::numeric_limits<float>::max()};
+  float max_{std::numeric_limits<float>::lowest()};
+};
+
+static_assert(sizeof(CompactStatistic) == 32,
+              "CompactStatistic is expected to fit in 32 bytes.");
+
+/*
+ * Structure-of-arrays container of compact statistics.
+ *
+ * Keeps one statistic per entity (e.g. tracked object) in separate contiguous
+ * arrays for count, sum, squared sum and extrema. Updating all entities at once
+ * through `add(values)` streams through memory linearly and vectorizes, and
+ * reports only touch the arrays they need.
+ */
+class StatisticArray {
+ public:
+  StatisticArray(const std::string_view name = "StatisticArray",
+                 const std::size_t size = 0)
+    : name_(NameTable::intern(name)) {
+    resize(size);
+  }
+
+  void resize(const std::size_t size) {
+    n_.resize(size, 0u);
+    sum_.resize(size, 0.0);
+    ssum_.resize(size, 0.0);
+    min_.resize(size, std::numeric_limits<float>::max());
+    max_.resize(size, std::numeric_limits<float>::lowest());
+  }
+
+  [[nodiscard]] std::size_t size() const { return n_.size(); }
+
+  /// Adds a sample to entity `i`.
+  Scalar add(const std::size_t i, const Scalar in) {
+    if (!std::isfinite(in)) return std::numeric_limits<Scalar>::quiet_NaN();
+
+    ++n_[i];
+    sum_[i] += in;
+    ssum_[i] += in * in;
+    min_[i] = std::min((float)in, min_[i]);
+    max_[i] = std::max((float)in, max_[i]);
+
+    return sum_[i] / (Scalar)n_[i];
+  }
+
+  /// Adds one sample to each entity, `in` must hold `size()` values.
+  void add(const Scalar *const in) {
+    const std::size_t size = n_.size();
+    for (std::size_t i = 0; i < size; ++i) {
+      const bool valid = std::isfinite(in[i]);
+      const Scalar x = valid ? in[i] : 0.0;
+      n_[i] += (std::uint32_t)valid;
+      sum_[i] += x;
+      ssum_[i] += x * x;
+      min_[i] = valid ? std::min((float)x, min_[i]) : min_[i];
+      max_[i] = valid ? std::max((float)x, max_[i]) : max_[i];
+    }
+  }
+
+  /// Adds one sample to each entity, throws if `in` does not hold `size()`
+  /// values.
+  void add(const std::vector<Scalar> &in) {
+    if (in.size() != size())
+      throw std::invalid_argument("StatisticArray: got " +
+                                  std::to_string(in.size()) + " values for " +
+                                  std::to_string(size()) + " entities");
+    add(in.data());
+  }
+
+  /// Merges a compact statistic into entity `i`.
+  void merge(const std::size_t i, const CompactStatistic &rhs) {
+    n_[i] += rhs.n_;
+    sum_[i] += rhs.sum_;
+    ssum_[i] += rhs.ssum_;
+    min_[i] = std::min(rhs.min_, min_[i]);
+    max_[i] = std::max(rhs.max_, max_[i]);
+  }
+
+  /// Gathers the state of entity `i` into a compact statistic.
+  [[nodiscard]] CompactStatistic operator[](const std::size_t i) const {
+    CompactStatistic s(name_);
+    s.n_ = n_[i];
+    s.sum_ = sum_[i];
+    s.ssum_ = ssum_[i];
+    s.min_ = min_[i];
+    s.max_ = max_[i];
+    return s;
+  }
+
+  /// Merges all entities into a single statistic.
+  [[nodiscard]] CompactStatistic total() const {
+    CompactStatistic s(name_);
+    const std::size_t size = n_.size();
+    for (std::size_t i = 0; i < size; ++i) s.merge((*this)[i]);
+    return s;
+  }
+
+  [[nodiscard]] int count(const std::size_t i) const { return (int)n_[i]; }
+  [[nodiscard]] Scalar mean(const std::size_t i) const {
+    return sum_[i] / ((Scalar)n_[i]);
+  }
+  [[nodiscard]] Scalar std(const std::size_t i) const {
+    return (*this)[i].std();
+  }
+  [[nodiscard]] Scalar min(const std::size_t i) const {
+    return (Scalar)min_[i];
+  }
+  [[nodiscard]] Scalar max(const std::size_t i) const {
+    return (Scalar)max_[i];
+  }
+  [[nodiscard]] Scalar sum(const std::size_t i) const { return sum_[i]; }
+
+  [[nodiscard]] NameId nameId() const { return name_; }
+  [[nodiscard]] const std::string &name() const {
+    return NameTable::name(name_);
+  }
+
+  void reset() {
+    const std::size_t n = size();
+    n_.clear();
+    sum_.clear();
+    ssum_.clear();
+    min_.clear();
+    max_.clear();
+    resize(n);
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const StatisticArray &s) {
+    return os << s.total();
+  }
+
+ private:
+  NameId name_;
+  std::vector<std::uint32_t> n_;
+  std::vector<Scalar> sum_;
+  std::vector<Scalar> ssum_;
+  std::vector<float> min_;
+  std::vector<float> max_;
+};
+
+}  // namespace effortless
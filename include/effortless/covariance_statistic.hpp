@@ -0,0 +1,227 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace effortless {
+
+using Scalar = double;
+
+/*
+ * Online covariance between two paired streams of samples.
+ *
+ * Tracks the means, variances and the co-moment of pairs `(x, y)` with
+ * Welford-style updates, without storing samples. Provides the covariance, the
+ * Pearson correlation and the least-squares slope of `y` over `x`, e.g. to see
+ * whether a latency `y` scales with a payload size `x`.
+ * Statistics from different threads can be combined exactly with `merge()`.
+ */
+class CovarianceStatistic {
+ public:
+  CovarianceStatistic(const std::string &name = "Covariance") : name_(name) {}
+  CovarianceStatistic(const CovarianceStatistic &rhs) = default;
+  CovarianceStatistic &operator=(const CovarianceStatistic &rhs) {
+    n_ = rhs.n_;
+    mean_x_ = rhs.mean_x_;
+    mean_y_ = rhs.mean_y_;
+    m2_x_ = rhs.m2_x_;
+    m2_y_ = rhs.m2_y_;
+    c_xy_ = rhs.c_xy_;
+    return *this;
+  }
+
+  /// Adds a sample pair, returns the current correlation.
+  Scalar add(const Scalar x, const Scalar y) {
+    if (!std::isfinite(x) || !std::isfinite(y))
+      return std::numeric_limits<Scalar>::quiet_NaN();
+
+    ++n_;
+    const Scalar dx = x - mean_x_;
+    const Scalar dy = y - mean_y_;
+    mean_x_ += dx / (Scalar)n_;
+    mean_y_ += dy / (Scalar)n_;
+    m2_x_ += dx * (x - mean_x_);
+    m2_y_ += dy * (y - mean_y_);
+    c_xy_ += dx * (y - mean_y_);
+
+    return correlation();
+  }
+
+  /// Merges the samples of `rhs` into this statistic.
+  CovarianceStatistic &merge(const CovarianceStatistic &rhs) {
+    if (rhs.n_ < 1) return *this;
+    if (n_ < 1) return operator=(rhs);
+
+    const Scalar na = (Scalar)n_;
+    const Scalar nb = (Scalar)rhs.n_;
+    const Scalar n = na + nb;
+    const Scalar dx = rhs.mean_x_ - mean_x_;
+    const Scalar dy = rhs.mean_y_ - mean_y_;
+
+    n_ += rhs.n_;
+    mean_x_ += dx * nb / n;
+    mean_y_ += dy * nb / n;
+    m2_x_ += rhs.m2_x_ + dx * dx * na * nb / n;
+    m2_y_ += rhs.m2_y_ + dy * dy * na * nb / n;
+    c_xy_ += rhs.c_xy_ + dx * dy * na * nb / n;
+    return *this;
+  }
+
+  CovarianceStatistic &operator+=(const CovarianceStatistic &rhs) {
+    return merge(rhs);
+  }
+
+  [[nodiscard]] int count() const { return n_; }
+  [[nodiscard]] Scalar meanX() const { return mean_x_; }
+  [[nodiscard]] Scalar meanY() const { return mean_y_; }
+  [[nodiscard]] Scalar varianceX() const { return n_ ? m2_x_ / n_ : 0.0; }
+  [[nodiscard]] Scalar varianceY() const { return n_ ? m2_y_ / n_ : 0.0; }
+  [[nodiscard]] Scalar covariance() const { return n_ ? c_xy_ / n_ : 0.0; }
+
+  /// Pearson correlation coefficient in [-1, 1].
+  [[nodiscard]] Scalar correlation() const {
+    const Scalar denominator = std::sqrt(m2_x_ * m2_y_);
+    return denominator > 0.0 ? c_xy_ / denominator : 0.0;
+  }
+
+  /// Least-squares slope of `y` over `x`.
+  [[nodiscard]] Scalar slope() const {
+    return m2_x_ > 0.0 ? c_xy_ / m2_x_ : 0.0;
+  }
+
+  /// Least-squares intercept of `y` at `x = 0`.
+  [[nodiscard]] Scalar intercept() const {
+    return mean_y_ - slope() * mean_x_;
+  }
+
+  [[nodiscard]] const std::string &name() const { return name_; }
+
+  void reset() {
+    n_ = 0;
+    mean_x_ = 0.0;
+    mean_y_ = 0.0;
+    m2_x_ = 0.0;
+    m2_y_ = 0.0;
+    c_xy_ = 0.0;
+  }
+
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const CovarianceStatistic &s) {
+    if (s.n_ < 1) {
+      os << s.name_ << " has no sample yet!" << std::endl;
+      return os;
+    }
+
+    const std::streamsize prec = os.precision();
+    os.precision(3);
+
+    os << std::left << std::setw(16) << s.name_ << "cov|corr  ";
+    os << std::left << std::setw(5) << s.covariance() << "|";
+    os << std::left << std::setw(5) << s.correlation();
+    os << "  [slope|offset:  ";
+    os << std::left << std::setw(5) << s.slope() << "|";
+    os << std::left << std::setw(5) << s.intercept() << "]" << std::endl;
+
+    os.precision(prec);
+    return os;
+  }
+
+ private:
+  const std::string name_;
+  int n_{0};
+  Scalar mean_x_{0.0};
+  Scalar mean_y_{0.0};
+  Scalar m2_x_{0.0};
+  Scalar m2_y_{0.0};
+  Scalar c_xy_{0.0};
+};
+
+/*
+ * Online covariance matrix of a fixed number `N` of paired streams.
+ *
+ * The N-dimensional variant of `CovarianceStatistic`, e.g. for latency against
+ * payload size and queue depth at once. Keeps the means and the full matrix of
+ * co-moments in fixed-size arrays, so it never allocates.
+ */
+template<std::size_t N> class CovarianceMatrixStatistic {
+ public:
+  using Vector = std::array<Scalar, N>;
+
+  CovarianceMatrixStatistic(const std::string &name = "Covariance")
+    : name_(name) {}
+
+  /// Adds one sample of all `N` streams.
+  void add(const Vector &x) {
+    for (const Scalar xi : x)
+      if (!std::isfinite(xi)) return;
+
+    ++n_;
+    Vector delta;
+    for (std::size_t i = 0; i < N; ++i) {
+      delta[i] = x[i] - mean_[i];
+      mean_[i] += delta[i] / (Scalar)n_;
+    }
+    for (std::size_t i = 0; i < N; ++i)
+      for (std::size_t j = 0; j < N; ++j)
+        c_[i * N + j] += delta[i] * (x[j] - mean_[j]);
+  }
+
+  /// Merges the samples of `rhs` into this statistic.
+  CovarianceMatrixStatistic &merge(const CovarianceMatrixStatistic &rhs) {
+    if (rhs.n_ < 1) return *this;
+
+    const Scalar na = (Scalar)n_;
+    const Scalar nb = (Scalar)rhs.n_;
+    const Scalar n = na + nb;
+    Vector delta;
+    for (std::size_t i = 0; i < N; ++i) delta[i] = rhs.mean_[i] - mean_[i];
+
+    for (std::size_t i = 0; i < N; ++i)
+      for (std::size_t j = 0; j < N; ++j)
+        c_[i * N + j] +=
+          rhs.c_[i * N + j] + delta[i] * delta[j] * na * nb / n;
+    for (std::size_t i = 0; i < N; ++i) mean_[i] += delta[i] * nb / n;
+    n_ += rhs.n_;
+    return *this;
+  }
+
+  [[nodiscard]] int count() const { return n_; }
+  [[nodiscard]] Scalar mean(const std::size_t i) const { return mean_[i]; }
+  [[nodiscard]] Scalar covariance(const std::size_t i,
+                                  const std::size_t j) const {
+    return n_ ? c_[i * N + j] / n_ : 0.0;
+  }
+
+  /// Pearson correlation coefficient between streams `i` and `j`.
+  [[nodiscard]] Scalar correlation(const std::size_t i,
+                                   const std::size_t j) const {
+    const Scalar denominator = std::sqrt(c_[i * N + i] * c_[j * N + j]);
+    return denominator > 0.0 ? c_[i * N + j] / denominator : 0.0;
+  }
+
+  /// Least-squares slope of stream `j` over stream `i`.
+  [[nodiscard]] Scalar slope(const std::size_t i, const std::size_t j) const {
+    return c_[i * N + i] > 0.0 ? c_[i * N + j] / c_[i * N + i] : 0.0;
+  }
+
+  [[nodiscard]] const std::string &name() const { return name_; }
+
+  void reset() {
+    n_ = 0;
+    mean_.fill(0.0);
+    c_.fill(0.0);
+  }
+
+ private:
+  const std::string name_;
+  int n_{0};
+  Vector mean_{};
+  std::array<Scalar, N * N> c_{};
+};
+
+}  // namespace effortless
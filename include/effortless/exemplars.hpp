@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace effortless {
+
+using Scalar = double;
+
+/// Tag of a sample, like a request id or iteration index.
+struct Tag {
+  std::uint64_t id;
+};
+
+/// A sample kept as exemplar, with its tag and the wall time it was added.
+struct Exemplar {
+  Scalar value;
+  std::uint64_t tag;
+  bool tagged;
+  std::chrono::system_clock::time_point time;
+
+  bool operator>(const Exemplar &rhs) const { return value > rhs.value; }
+};
+
+/*
+ * Keeps the `k` largest samples of a stream together with their tags.
+ *
+ * Helps to find out which call caused a spike in the maximum of a timer.
+ * The exemplars are stored in a min-heap of size `k`, and the smallest kept
+ * value is cached, so adding a sample that is not among the largest costs a
+ * single comparison.
+ */
+class Exemplars {
+ public:
+  Exemplars(const std::size_t k = 5) : k_(std::max<std::size_t>(k, 1)) {
+    heap_.reserve(k_);
+  }
+
+  void add(const Scalar value) {
+    if (value <= threshold_) return;
+    insert({value, 0, false, std::chrono::system_clock::now()});
+  }
+
+  void add(const Scalar value, const Tag tag) {
+    if (value <= threshold_) return;
+    insert({value, tag.id, true, std::chrono::system_clock::now()});
+  }
+
+  /// Merges the exemplars of `rhs`, keeping the `k` largest of both.
+  Exemplars &merge(const Exemplars &rhs) {
+    for (const Exemplar &exemplar : rhs.heap_)
+      if (exemplar.value > threshold_) insert(exemplar);
+    return *this;
+  }
+
+  /// Returns the exemplars sorted from largest to smallest value.
+  [[nodiscard]] std::vector<Exemplar> sorted() const {
+    std::vector<Exemplar> exemplars = heap_;
+    std::sort_heap(exemplars.begin(), exemplars.end(), std::greater<>());
+    return exemplars;
+  }
+
+  [[nodiscard]] std::size_t size() const { return heap_.size(); }
+  [[nodiscard]] std::size_t k() const { return k_; }
+
+  void reset() {
+    heap_.clear();
+    threshold_ = std::numeric_limits<Scalar>::lowest();
+  }
+
+  /// Prints an exemplar with `scale` applied to its value, e.g. to ms.
+  static void print(std::ostream &os, const Exemplar &exemplar,
+                    const Scalar scale = 1.0) {
+    const std::time_t time =
+      std::chrono::system_clock::to_time_t(exemplar.time);
+    const long ms =
+      (long)(std::chrono::duration_cast<std::chrono::milliseconds>(
+               exemplar.time.time_since_epoch())
+               .count() %
+             1000);
+    // Exemplars are printed from reporting threads, std::localtime is not
+    // thread-safe.
+    std::tm tm;
+#if defined(_WIN32)
+    localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
+
+    os << std::right << std::setw(8) << scale * exemplar.value;
+    if (exemplar.tagged)
+      os << "  tag " << std::left << std::setw(10) << exemplar.tag;
+    else
+      os << "  " << std::left << std::setw(14) << "untagged";
+    os << "  at " << std::put_time(&tm, "%H:%M:%S") << '.' << std::setfill('0')
+       << std::right << std::setw(3) << ms << std::setfill(' ');
+  }
+
+ private:
+  void insert(const Exemplar &exemplar) {
+    if (heap_.size() < k_) {
+      heap_.push_back(exemplar);
+      std::push_heap(heap_.begin(), heap_.end(), std::greater<>());
+    } else {
+      std::pop_heap(heap_.begin(), heap_.end(), std::greater<>());
+      heap_.back() = exemplar;
+      std::push_heap(heap_.begin(), heap_.end(), std::greater<>());
+    }
+    if (heap_.size() == k_) threshold_ = heap_.front().value;
+  }
+
+  std::size_t k_;
+  Scalar threshold_{std::numeric_limits<Scalar>::lowest()};
+  std::vector<Exemplar> heap_;
+};
+
+}  // namespace effortless
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "effortless/call_tree.hpp"
+#include "effortless/timer.hpp"
+
+namespace effortless {
+
+/*
+ * Writes timer trees as folded stacks, the input format of flamegraph tools.
+ *
+ * Each node becomes one line `root;child;node weight`, weighted by its
+ * exclusive time in multiples of `unit`, microseconds by default, and nodes
+ * without exclusive time are omitted. The output can go straight into
+ * `flamegraph.pl` or speedscope. The tree is walked iteratively, reusing one
+ * buffer for the current path, so large trees are written in linear time.
+ */
+class Flamegraph {
+ public:
+  /// Writes a timer and its nested timers.
+  template<typename Clock>
+  static void write(std::ostream &os, const BasicTimer<Clock> &timer,
+                    const Scalar unit = 1e-6) {
+    std::string path;
+    std::vector<std::pair<const BasicTimer<Clock> *, std::size_t>> stack{
+      {&timer, 0}};
+    while (!stack.empty()) {
+      const auto [node, length] = stack.back();
+      stack.pop_back();
+      push(path, length, node->name());
+
+      Scalar exclusive = node->sum();
+      const std::size_t first = stack.size();
+      node->forEachNested([&](const BasicTimer<Clock> &nested) {
+        exclusive -= nested.sum();
+        stack.emplace_back(&nested, path.size());
+      });
+      std::reverse(stack.begin() + (std::ptrdiff_t)first, stack.end());
+      line(os, path, exclusive, unit);
+    }
+  }
+
+  /// Writes a call tree, e.g. `CallTree::thread()`.
+  static void write(std::ostream &os, const CallTree &tree,
+                    const Scalar unit = 1e-6) {
+    std::string path;
+    TreeStack stack;
+    pushChildren(stack, tree, CallTree::ROOT, 0);
+    while (!stack.empty()) {
+      const auto [node, length] = stack.back();
+      stack.pop_back();
+      push(path, length, tree.name(node));
+      line(os, path, tree.exclusive(node), unit);
+      pushChildren(stack, tree, node, path.size());
+    }
+  }
+
+ private:
+  /// Truncates the path to its parent and appends a frame.
+  static void push(std::string &path, const std::size_t length,
+                   const std::string &name) {
+    path.resize(length);
+    if (length) path += ';';
+    for (const char c : name) path += c == ';' || c == '\n' ? ' ' : c;
+  }
+
+  static void line(std::ostream &os, const std::string &path,
+                   const Scalar exclusive, const Scalar unit) {
+    const long long weight = std::llround(exclusive / unit);
+    if (weight > 0) os << path << ' ' << weight << '\n';
+  }
+
+  using TreeStack = std::vector<std::pair<CallTree::Index, std::size_t>>;
+
+  static void pushChildren(TreeStack &stack, const CallTree &tree,
+                           const CallTree::Index node,
+                           const std::size_t length) {
+    const std::size_t first = stack.size();
+    for (CallTree::Index c = tree[node].first_child; c != CallTree::NONE;
+         c = tree[c].next_sibling)
+      stack.emplace_back(c, length);
+    std::reverse(stack.begin() + (std::ptrdiff_t)first, stack.end());
+  }
+};
+
+}  // namespace effortless
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "effortless/statistic.hpp"
+
+namespace effortless {
+
+/*
+ * Synchronizes wait-free writers with a reader that flips between phases.
+ *
+ * Writers wrap their updates in `writerEnter()` and `writerExit()`, costing
+ * one atomic increment each. The reader calls `flipPhase()`, which returns
+ * once all writers that entered before the flip have exited, so that data the
+ * writers switched away from can be read safely.
+ */
+class WriterReaderPhaser {
+ public:
+  std::int64_t writerEnter() {
+    return start_epoch_.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  void writerExit(const std::int64_t critical_value) {
+    (critical_value < 0 ? odd_end_epoch_ : even_end_epoch_)
+      .fetch_add(1, std::memory_order_release);
+  }
+
+  /// Flips the phase and waits for writers of the previous phase.
+  /// Only one reader may flip at a time.
+  void flipPhase() {
+    const bool next_phase_even = start_epoch_.load() < 0;
+    const std::int64_t initial =
+      next_phase_even ? 0 : std::numeric_limits<std::int64_t>::min();
+    (next_phase_even ? even_end_epoch_ : odd_end_epoch_).store(initial);
+
+    const std::int64_t start_at_flip = start_epoch_.exchange(initial);
+    std::atomic<std::int64_t> &end_epoch =
+      next_phase_even ? odd_end_epoch_ : even_end_epoch_;
+    while (end_epoch.load(std::memory_order_acquire) != start_at_flip)
+      std::this_thread::yield();
+  }
+
+ private:
+  std::atomic<std::int64_t> start_epoch_{0};
+  std::atomic<std::int64_t> even_end_epoch_{0};
+  std::atomic<std::int64_t> odd_end_epoch_{
+    std::numeric_limits<std::int64_t>::min()};
+};
+
+/*
+ * Statistic that hands out per-interval snapshots without losing samples.
+ *
+ * Printing a statistic and then calling `reset()` from a reporting thread
+ * loses the samples added in between and races with the writer. This class
+ * double-buffers the statistic: the writer always adds to the active buffer,
+ * while `snapshotAndRotate()` swaps in a fresh buffer and returns the previous
+ * one once the writer is guaranteed to have left it. Every sample is therefore
+ * counted in exactly one interval, and the interval duration is measured, so
+ * per-interval counts, rates and reservoir percentiles are exact.
+ *
+ * Several readers, like a `Watcher` and a `Reporter`, can share one instance
+ * by each taking their snapshots as a consumer from `subscribe()`. Rotating
+ * hands the samples of the writer to all consumers, so every sample is in
+ * exactly one interval of each consumer, no matter how the readers interleave.
+ * The consumer 0 always exists and is used by default.
+ *
+ * Adding is wait-free, but not safe for concurrent writers; use one instance
+ * per writer thread and merge their snapshots.
+ */
+class IntervalStatistic {
+ public:
+  struct Interval {
+    Statistic statistic;
+    Scalar seconds;
+
+    /// Samples per second in this interval.
+    [[nodiscard]] Scalar rate() const {
+      return seconds > 0.0 ? statistic.count() / seconds : 0.0;
+    }
+  };
+
+  using Consumer = std::size_t;
+
+  IntervalStatistic(const std::string &name = "IntervalStatistic")
+    : buffers_{Statistic(name), Statistic(name)}, prototype_(name) {
+    subscribe();
+  }
+
+  Scalar operator<<(const Scalar in) {
+    const std::int64_t critical = phaser_.writerEnter();
+    const Scalar mean = active_.load(std::memory_order_acquire)->add(in);
+    phaser_.writerExit(critical);
+    return mean;
+  }
+
+  Scalar add(const Scalar in) { return operator<<(in); }
+
+  /// Returns the statistic of `consumer` since its last snapshot, while the
+  /// writer continues into a fresh one. Thread-safe with respect to the writer
+  /// and other consumers.
+  Interval snapshotAndRotate(const Consumer consumer = 0) {
+    const std::lock_guard<std::mutex> lock(reader_mutex_);
+    Statistic *const previous = active_.load();
+    Statistic *const next = previous == &buffers_[0] ? &buffers_[1]
+                                                     : &buffers_[0];
+    next->reset();
+    active_.store(next);
+    phaser_.flipPhase();
+    for (Pending &pending : pending_)
+      if (pending.subscribed) pending.statistic.merge(*previous);
+
+    Pending &pending = pending_[consumer];
+    const std::chrono::steady_clock::time_point t_now =
+      std::chrono::steady_clock::now();
+    const Scalar seconds =
+      1e-9 * (Scalar)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               t_now - pending.t_interval)
+               .count();
+    pending.t_interval = t_now;
+    Interval interval{pending.statistic, seconds};
+    pending.statistic.reset();
+    return interval;
+  }
+
+  /// Adds a consumer taking its own snapshots, starting with the samples
+  /// since the last rotation of any consumer.
+  Consumer subscribe() {
+    const std::lock_guard<std::mutex> lock(reader_mutex_);
+    for (Consumer i = 0; i < pending_.size(); ++i) {
+      if (pending_[i].subscribed) continue;
+      pending_[i] = newPending();
+      return i;
+    }
+    pending_.push_back(newPending());
+    return pending_.size() - 1;
+  }
+
+  /// Removes a consumer, whose id may be reused by `subscribe()`.
+  void unsubscribe(const Consumer consumer) {
+    const std::lock_guard<std::mutex> lock(reader_mutex_);
+    if (consumer > 0 && consumer < pending_.size())
+      pending_[consumer].subscribed = false;
+  }
+
+  /// Enables higher moments for all intervals. Throws like
+  /// `Statistic::enableMoments()` once samples were added.
+  void enableMoments(const bool enable = true) {
+    const std::lock_guard<std::mutex> lock(reader_mutex_);
+    bool empty = true;
+    for (const Statistic &buffer : buffers_) empty &= buffer.count() == 0;
+    for (const Pending &pending : pending_)
+      empty &= pending.statistic.count() == 0;
+    if (enable && !empty)
+      throw std::logic_error(std::string("IntervalStatistic '") + name() +
+                             "': enable moments before adding samples");
+    for (Statistic &buffer : buffers_) buffer.enableMoments(enable);
+    prototype_.enableMoments(enable);
+    for (Pending &pending : pending_) pending.statistic.enableMoments(enable);
+  }
+
+  /// Enables a reservoir for all intervals, call before adding samples.
+  void enableReservoir(const std::size_t capacity = 1024) {
+    const std::lock_guard<std::mutex> lock(reader_mutex_);
+    for (Statistic &buffer : buffers_) buffer.enableReservoir(capacity);
+    prototype_.enableReservoir(capacity);
+    for (Pending &pending : pending_)
+      pending.statistic.enableReservoir(capacity);
+  }
+
+  [[nodiscard]] const std::string &name() const { return prototype_.name(); }
+
+  /// Whether the intervals have a reservoir for quantiles.
+  [[nodiscard]] bool sampled() const {
+    const std::lock_guard<std::mutex> lock(reader_mutex_);
+    return prototype_.reservoir() != nullptr;
+  }
+
+ private:
+  /// Samples handed to a consumer since its last snapshot.
+  struct Pending {
+    Statistic statistic;
+    std::chrono::steady_clock::time_point t_interval;
+    bool subscribed;
+  };
+
+  /// A consumer with the configuration of the buffers, never written to by
+  /// the writer, so it can be read at any time.
+  Pending newPending() const {
+    return {prototype_, std::chrono::steady_clock::now(), true};
+  }
+
+  std::array<Statistic, 2> buffers_;
+  std::atomic<Statistic *> active_{&buffers_[0]};
+  WriterReaderPhaser phaser_;
+  mutable std::mutex reader_mutex_;
+  /// Empty statistic with the configuration of the buffers.
+  Statistic prototype_;
+  std::deque<Pending> pending_;
+};
+
+}  // namespace effortless
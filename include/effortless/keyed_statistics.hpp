@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "effortless/compact_statistic.hpp"
+
+namespace effortless {
+
+/// Hash for keyed statistics, mixing the bits of `std::hash` for probing.
+template<typename Key> struct KeyHash {
+  template<typename K> std::size_t operator()(const K &key) const {
+    return mix((std::uint64_t)std::hash<Key>{}(key));
+  }
+
+  static std::size_t mix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (std::size_t)h;
+  }
+};
+
+/// String keys hash as `std::string_view`, allowing lookup without copies.
+template<> struct KeyHash<std::string> {
+  std::size_t operator()(const std::string_view key) const {
+    return KeyHash<std::size_t>::mix(
+      (std::uint64_t)std::hash<std::string_view>{}(key));
+  }
+};
+
+/*
+ * Statistics for a dynamic set of keys, like message types or object ids.
+ *
+ * Use it as `stats[key] << value`. The keys and their `CompactStatistic`s are
+ * stored inline in one contiguous array, indexed by a flat open-addressing
+ * table with linear probing, so an update costs one hash and typically a
+ * single cache miss. Lookups are heterogeneous, e.g. string keys can be
+ * queried with `std::string_view` or `const char *` without allocation.
+ *
+ * If constructed with a `max_size`, the container is bounded and inserting a
+ * new key into a full container evicts the least-recently-updated key.
+ *
+ * References returned by `operator[]` are invalidated when the container
+ * grows, just like for `std::vector`.
+ */
+template<typename Key, typename Hash = KeyHash<Key>> class KeyedStatistics {
+ public:
+  enum class Order { Mean, Max, Count };
+
+  KeyedStatistics(const std::string_view name = "KeyedStatistics",
+                  const std::size_t max_size = 0)
+    : name_(NameTable::intern(name)), max_size_(max_size) {
+    if (max_size_) {
+      entries_.reserve(max_size_);
+      rehash(2 * max_size_);
+    } else {
+      rehash(16);
+    }
+  }
+
+  /// Returns the statistic of `key`, inserting it if needed.
+  template<typename K> CompactStatistic &operator[](const K &key) {
+    const std::size_t hash = hasher_(key);
+    std::size_t slot = hash & mask_;
+    for (; slots_[slot] != EMPTY; slot = (slot + 1) & mask_) {
+      const std::uint32_t index = slots_[slot];
+      Entry &entry = entries_[index];
+      if (entry.hash == hash && entry.key == key) {
+        if (max_size_) touch(index);
+        return entry.stat;
+      }
+    }
+    return insert(Key(key), hash, slot);
+  }
+
+  /// Returns the statistic of `key` or `nullptr` if it is not present.
+  template<typename K>
+  [[nodiscard]] const CompactStatistic *find(const K &key) const {
+    const std::size_t hash = hasher_(key);
+    for (std::size_t slot = hash & mask_; slots_[slot] != EMPTY;
+         slot = (slot + 1) & mask_) {
+      const Entry &entry = entries_[slots_[slot]];
+      if (entry.hash == hash && entry.key == key) return &entry.stat;
+    }
+    return nullptr;
+  }
+
+  template<typename K> [[nodiscard]] bool contains(const K &key) const {
+    return find(key) != nullptr;
+  }
+
+  [[nodiscard]] std::size_t size() const { return entries_.size(); }
+  [[nodiscard]] bool empty() const { return entries_.empty(); }
+  [[nodiscard]] std::size_t maxSize() const { return max_size_; }
+  [[nodiscard]] std::size_t evictions() const { return evictions_; }
+
+  [[nodiscard]] const std::string &name() const {
+    return NameTable::name(name_);
+  }
+
+  /// Calls `f(key, stat)` for all keys in unspecified order.
+  template<typename F> void forEach(F &&f) const {
+    for (const Entry &entry : entries_) f(entry.key, entry.stat);
+  }
+
+  /// Removes all keys.
+  void clear() {
+    entries_.clear();
+    std::fill(slots_.begin(), slots_.end(), EMPTY);
+    head_ = tail_ = EMPTY;
+  }
+
+  /// Returns the `k` keys with the largest mean, max or count, sorted.
+  [[nodiscard]] std::vector<std::pair<Key, CompactStatistic>> top(
+    const std::size_t k, const Order order = Order::Mean) const {
+    std::vector<std::uint32_t> indices(entries_.size());
+    for (std::size_t i = 0; i < indices.size(); ++i)
+      indices[i] = (std::uint32_t)i;
+
+    const std::size_t n = std::min(k, indices.size());
+    std::partial_sort(indices.begin(), indices.begin() + (std::ptrdiff_t)n,
+                      indices.end(),
+                      [&](const std::uint32_t a, const std::uint32_t b) {
+                        return value(entries_[a].stat, order) >
+                               value(entries_[b].stat, order);
+                      });
+
+    std::vector<std::pair<Key, CompactStatistic>> result;
+    result.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+      result.emplace_back(entries_[indices[i]].key, entries_[indices[i]].stat);
+    return result;
+  }
+
+  /// Prints the top `k` keys, sorted by `order`.
+  void printTop(std::ostream &os, const std::size_t k,
+                const Order order = Order::Mean) const {
+    const std::streamsize prec = os.precision();
+    os.precision(3);
+
+    os << name() << ": " << size() << " keys";
+    if (evictions_) os << ", " << evictions_ << " evicted";
+    os << std::endl;
+    for (const auto &[key, stat] : top(k, order)) {
+      os << "  " << std::left << std::setw(24) << key;
+      os << std::right << std::setw(8) << stat.count() << "  samples   "
+         << "mean|std: ";
+      os << std::right << std::setw(8) << stat.mean() << " | ";
+      os << std::left << std::setw(8) << stat.std() << "  [min|max:  ";
+      os << std::right << std::setw(8) << stat.min() << " | ";
+      os << std::left << std::setw(8) << stat.max() << "]" << std::endl;
+    }
+
+    os.precision(prec);
+  }
+
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const KeyedStatistics &stats) {
+    stats.printTop(os, stats.size());
+    return os;
+  }
+
+ private:
+  static constexpr std::uint32_t EMPTY = 0xffffffffu;
+
+  struct Entry {
+    Key key;
+    CompactStatistic stat;
+    std::size_t hash;
+    std::uint32_t prev;
+    std::uint32_t next;
+  };
+
+  static Scalar value(const CompactStatistic &stat, const Order order) {
+    switch (order) {
+      case Order::Max:
+        return stat.max();
+      case Order::Count:
+        return (Scalar)stat.count();
+      default:
+        return stat.mean();
+    }
+  }
+
+  CompactStatistic &insert(Key &&key, const std::size_t hash,
+                           std::size_t slot) {
+    if (max_size_ && entries_.size() >= max_size_) {
+      const std::uint32_t index = evict();
+      slot = freeSlot(hash);
+      Entry &entry = entries_[index];
+      entry.key = std::move(key);
+      entry.stat = CompactStatistic();
+      entry.hash = hash;
+      slots_[slot] = index;
+      pushFront(index);
+      return entry.stat;
+    }
+
+    if (2 * (entries_.size() + 1) > slots_.size()) {
+      rehash(2 * slots_.size());
+      slot = freeSlot(hash);
+    }
+
+    const std::uint32_t index = (std::uint32_t)entries_.size();
+    entries_.push_back(
+      {std::move(key), CompactStatistic(), hash, EMPTY, EMPTY});
+    slots_[slot] = index;
+    if (max_size_) pushFront(index);
+    return entries_.back().stat;
+  }
+
+  void rehash(const std::size_t min_slots) {
+    std::size_t n = 16;
+    while (n < min_slots) n *= 2;
+    slots_.assign(n, EMPTY);
+    mask_ = n - 1;
+    for (std::uint32_t i = 0; i < (std::uint32_t)entries_.size(); ++i)
+      slots_[freeSlot(entries_[i].hash)] = i;
+  }
+
+  [[nodiscard]] std::size_t freeSlot(const std::size_t hash) const {
+    std::size_t slot = hash & mask_;
+    while (slots_[slot] != EMPTY) slot = (slot + 1) & mask_;
+    return slot;
+  }
+
+  /// Removes the least-recently-updated key and returns its free entry.
+  std::uint32_t evict() {
+    const std::uint32_t index = tail_;
+    unlink(index);
+
+    std::size_t slot = entries_[index].hash & mask_;
+    while (slots_[slot] != index) slot = (slot + 1) & mask_;
+
+    // Backward shift deletion keeps probe sequences without tombstones.
+    std::size_t next = slot;
+    while (true) {
+      next = (next + 1) & mask_;
+      if (slots_[next] == EMPTY) break;
+      const std::size_t home = entries_[slots_[next]].hash & mask_;
+      if (((next - home) & mask_) >= ((next - slot) & mask_)) {
+        slots_[slot] = slots_[next];
+        slot = next;
+      }
+    }
+    slots_[slot] = EMPTY;
+
+    ++evictions_;
+    return index;
+  }
+
+  void touch(const std::uint32_t index) {
+    if (index == head_) return;
+    unlink(index);
+    pushFront(index);
+  }
+
+  void unlink(const std::uint32_t index) {
+    Entry &entry = entries_[index];
+    if (entry.prev != EMPTY)
+      entries_[entry.prev].next = entry.next;
+    else
+      head_ = entry.next;
+    if (entry.next != EMPTY)
+      entries_[entry.next].prev = entry.prev;
+    else
+      tail_ = entry.prev;
+  }
+
+  void pushFront(const std::uint32_t index) {
+    Entry &entry = entries_[index];
+    entry.prev = EMPTY;
+    entry.next = head_;
+    if (head_ != EMPTY) entries_[head_].prev = index;
+    head_ = index;
+    if (tail_ == EMPTY) tail_ = index;
+  }
+
+  NameId name_;
+  std::size_t max_size_;
+  std::size_t evictions_{0};
+  Hash hasher_;
+  std::size_t mask_{0};
+  std::vector<std::uint32_t> slots_;
+  std::vector<Entry> entries_;
+  std::uint32_t head_{EMPTY};
+  std::uint32_t tail_{EMPTY};
+};
+
+}  // namespace effortless
@@ -66,7 +66,7 @@ class Logger {
   Logger() = delete;
   Logger(const Logger &) = delete;
   Logger(const Logger &&) = delete;
-  ~Logger() = default;
+  virtual ~Logger() = default;
 
   std::streamsize precision(const std::streamsize n) {
     return sink_->precision(n);
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "effortless/statistic.hpp"
+
+namespace effortless {
+
+/// Hardware events counted by `PerfCounters`.
+enum class PerfCounter : std::size_t {
+  Cycles,
+  Instructions,
+  CacheMisses,
+  BranchMisses
+};
+
+/*
+ * Group of hardware performance counters of the calling thread.
+ *
+ * Opens cycles, instructions, cache misses, and branch misses as one
+ * `perf_event_open` group counting in user space, so all counters run over the
+ * same interval, and reads them with a single `read()`. Counters that are
+ * multiplexed with other events only run part of the time, and are scaled to
+ * the full interval. For the counts over an interval, take two raw readings
+ * and scale their difference with `delta()`, as the difference of scaled
+ * totals is not the count over the interval. Use the lazily opened group of
+ * each thread from `thread()`.
+ *
+ * In containers, VMs without a virtual PMU, or with a restrictive
+ * `perf_event_paranoid`, the counters cannot be opened, in which case
+ * `available()` is false and reads return false.
+ */
+class PerfCounters {
+ public:
+  static constexpr std::size_t N = 4;
+  using Values = std::array<std::uint64_t, N>;
+
+  /// Raw counts with the times the group was enabled and running, in ns.
+  struct Reading {
+    Values raw{};
+    std::uint64_t enabled{0};
+    std::uint64_t running{0};
+  };
+
+  PerfCounters() {
+#if defined(__linux__)
+    static constexpr std::array<std::uint64_t, N> configs{
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (std::size_t i = 0; i < N; ++i) {
+      const int fd = open(configs[i], leader_);
+      if (fd < 0) continue;
+      if (leader_ < 0) leader_ = fd;
+      fds_[i] = fd;
+      index_[i] = (int)opened_++;
+    }
+#endif
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  ~PerfCounters() {
+#if defined(__linux__)
+    for (const int fd : fds_)
+      if (fd >= 0) close(fd);
+#endif
+  }
+
+  /// The counter group of the calling thread.
+  static PerfCounters &thread() {
+    thread_local PerfCounters counters;
+    return counters;
+  }
+
+  [[nodiscard]] bool available() const { return opened_ > 0; }
+
+  /// True if `counter` could be opened.
+  [[nodiscard]] bool available(const PerfCounter counter) const {
+    return index_[(std::size_t)counter] >= 0;
+  }
+
+  /// Reads the raw counts, unavailable ones read as zero.
+  bool read(Reading &reading) const {
+    reading = Reading();
+#if defined(__linux__)
+    if (leader_ < 0) return false;
+    // Layout of PERF_FORMAT_GROUP with enabled and running times.
+    std::array<std::uint64_t, 3 + N> buffer;
+    const ssize_t size = ::read(leader_, buffer.data(), sizeof(buffer));
+    if (size < (ssize_t)(3 * sizeof(std::uint64_t))) return false;
+
+    reading.enabled = buffer[1];
+    reading.running = buffer[2];
+    for (std::size_t i = 0; i < N; ++i)
+      if (index_[i] >= 0 && (std::uint64_t)index_[i] < buffer[0])
+        reading.raw[i] = buffer[3 + (std::size_t)index_[i]];
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /// Reads all counters since opened, scaled to the time enabled.
+  bool read(Values &values) const {
+    Reading reading;
+    return read(reading) && delta(Reading(), reading, values);
+  }
+
+  /// Counts between two readings, scaled to the time enabled in between.
+  /// Returns false if the counters did not run in between, or went backwards.
+  static bool delta(const Reading &from, const Reading &to, Values &values) {
+    values.fill(0);
+    if (to.running <= from.running || to.enabled < from.enabled) return false;
+    for (std::size_t i = 0; i < N; ++i)
+      if (to.raw[i] < from.raw[i]) return false;
+
+    const Scalar scale = (Scalar)(to.enabled - from.enabled) /
+                         (Scalar)(to.running - from.running);
+    for (std::size_t i = 0; i < N; ++i)
+      values[i] = (std::uint64_t)((Scalar)(to.raw[i] - from.raw[i]) * scale);
+    return true;
+  }
+
+ private:
+#if defined(__linux__)
+  static int open(const std::uint64_t config, const int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd,
+                        PERF_FLAG_FD_CLOEXEC);
+  }
+#endif
+
+  int leader_{-1};
+  std::size_t opened_{0};
+  std::array<int, N> fds_{-1, -1, -1, -1};
+  std::array<int, N> index_{-1, -1, -1, -1};
+};
+
+/*
+ * Statistics of hardware counters over timed intervals.
+ *
+ * Reads the counter group of the calling thread at the start and stop of each
+ * interval and keeps a `Statistic` of the counts per interval, from which
+ * reports derive instructions per cycle and misses per thousand instructions.
+ * Reading the group is a system call, so this adds around a microsecond per
+ * interval. If counters are unavailable, nothing is recorded.
+ */
+class PerfStatistic {
+ public:
+  /// Starts an interval on the calling thread.
+  void start() { valid_ = PerfCounters::thread().read(start_); }
+
+  /// Stops the interval and starts the next one. Intervals in which the
+  /// counters did not run are dropped.
+  void stop() {
+    PerfCounters::Reading end;
+    const bool valid = PerfCounters::thread().read(end);
+    PerfCounters::Values values;
+    if (valid && valid_ && PerfCounters::delta(start_, end, values))
+      for (std::size_t i = 0; i < PerfCounters::N; ++i)
+        counts_[i] << (Scalar)values[i];
+    start_ = end;
+    valid_ = valid;
+  }
+
+  PerfStatistic &merge(const PerfStatistic &rhs) {
+    for (std::size_t i = 0; i < PerfCounters::N; ++i)
+      counts_[i].merge(rhs.counts_[i]);
+    return *this;
+  }
+
+  /// Counts of `counter` per interval.
+  [[nodiscard]] const Statistic &operator[](const PerfCounter counter) const {
+    return counts_[(std::size_t)counter];
+  }
+
+  /// True if the counters of the calling thread are available.
+  [[nodiscard]] static bool available() {
+    return PerfCounters::thread().available();
+  }
+
+  [[nodiscard]] int count() const { return counts_[0].count(); }
+
+  /// Instructions per cycle.
+  [[nodiscard]] Scalar ipc() const {
+    return ratio(PerfCounter::Instructions, PerfCounter::Cycles);
+  }
+
+  /// Misses of `counter` per thousand instructions.
+  [[nodiscard]] Scalar mpki(const PerfCounter counter) const {
+    return 1000.0 * ratio(counter, PerfCounter::Instructions);
+  }
+
+  void reset() {
+    for (Statistic &count : counts_) count.reset();
+  }
+
+ private:
+  [[nodiscard]] Scalar ratio(const PerfCounter num,
+                             const PerfCounter den) const {
+    const Scalar sum = (*this)[den].sum();
+    return sum > 0.0 ? (*this)[num].sum() / sum : 0.0;
+  }
+
+  PerfCounters::Reading start_;
+  bool valid_{false};
+  std::array<Statistic, PerfCounters::N> counts_{
+    Statistic("cycles"), Statistic("instructions"), Statistic("cache misses"),
+    Statistic("branch misses")};
+};
+
+}  // namespace effortless
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "effortless/timer.hpp"
+
+namespace effortless {
+
+class ProfileTimer;
+
+/*
+ * Process-wide registry of `ProfileTimer`s, which register themselves.
+ *
+ * `dumpAll()` prints all registered timers sorted by their total time. Timers
+ * are read without synchronization, so dump at a quiescent point, like the end
+ * of the program or between iterations.
+ */
+class TimerRegistry {
+ public:
+  static TimerRegistry &instance() {
+    static TimerRegistry registry;
+    return registry;
+  }
+
+  void add(ProfileTimer *timer) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    timers_.push_back(timer);
+  }
+
+  void remove(const ProfileTimer *timer) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    timers_.erase(std::remove(timers_.begin(), timers_.end(), timer),
+                  timers_.end());
+  }
+
+  /// Returns the registered timers in order of registration.
+  [[nodiscard]] std::vector<ProfileTimer *> timers() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return timers_;
+  }
+
+  /// Returns the registered timers sorted by total time, longest first.
+  [[nodiscard]] std::vector<const ProfileTimer *> sorted() const;
+
+  [[nodiscard]] std::size_t size() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return timers_.size();
+  }
+
+  /// Prints all registered timers sorted by total time.
+  void dumpAll(std::ostream &os = std::cout) const;
+
+ private:
+  TimerRegistry() = default;
+
+  mutable std::mutex mutex_;
+  std::vector<ProfileTimer *> timers_;
+};
+
+/*
+ * Timer registered in the `TimerRegistry` for its whole lifetime.
+ *
+ * Meant as function-local static object, see `EFFORTLESS_PROFILE_SCOPE`,
+ * which also records the source location of the profiled scope. Like any
+ * `Timer`, it must only be tic-toc'ed from one thread at a time.
+ */
+class ProfileTimer : public Timer {
+ public:
+  ProfileTimer(const std::string &name, const char *file = "",
+               const int line = 0)
+    : Timer(name), file_(file), line_(line) {
+    TimerRegistry::instance().add(this);
+  }
+  ProfileTimer(const ProfileTimer &) = delete;
+  ~ProfileTimer() { TimerRegistry::instance().remove(this); }
+
+  [[nodiscard]] const char *file() const { return file_; }
+  [[nodiscard]] int line() const { return line_; }
+
+ private:
+  const char *file_;
+  int line_;
+};
+
+inline std::vector<const ProfileTimer *> TimerRegistry::sorted() const {
+  std::vector<const ProfileTimer *> timers;
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    timers.assign(timers_.begin(), timers_.end());
+  }
+  std::stable_sort(timers.begin(), timers.end(),
+                   [](const ProfileTimer *a, const ProfileTimer *b) {
+                     return a->sum() > b->sum();
+                   });
+  return timers;
+}
+
+inline void TimerRegistry::dumpAll(std::ostream &os) const {
+  for (const ProfileTimer *timer : sorted()) os << *timer;
+}
+
+/// Prints all registered profile timers sorted by total time.
+inline void dumpAll(std::ostream &os = std::cout) {
+  TimerRegistry::instance().dumpAll(os);
+}
+
+}  // namespace effortless
+
+#define EFFORTLESS_CONCAT_IMPL(a, b) a##b
+#define EFFORTLESS_CONCAT(a, b) EFFORTLESS_CONCAT_IMPL(a, b)
+
+/*
+ * Profiles the enclosing scope with a static, registered timer.
+ *
+ * Expands to a function-local static `ProfileTimer`, created on the first pass
+ * with the name and source location, and a `ScopedTicToc` on it. Compiles to
+ * nothing unless `EFFORTLESS_PROFILE` is defined, e.g. with the CMake option
+ * of the same name.
+ */
+#ifdef EFFORTLESS_PROFILE
+#define EFFORTLESS_PROFILE_SCOPE(name)                               \
+  EFFORTLESS_PROFILE_SCOPE_IMPL(                                     \
+    name, EFFORTLESS_CONCAT(effortless_profile_timer_, __LINE__),    \
+    EFFORTLESS_CONCAT(effortless_profile_scope_, __LINE__))
+#define EFFORTLESS_PROFILE_SCOPE_IMPL(name, timer, scope)            \
+  static ::effortless::ProfileTimer timer(name, __FILE__, __LINE__); \
+  const ::effortless::ScopedTicToc scope(timer)
+#else
+#define EFFORTLESS_PROFILE_SCOPE(name) static_assert(true, "")
+#endif
+
+/// Profiles the enclosing function, see `EFFORTLESS_PROFILE_SCOPE`.
+#define EFFORTLESS_PROFILE_FUNCTION() EFFORTLESS_PROFILE_SCOPE(__func__)
+
+/*
+ * Times the enclosing scope into a static timer that prints only now and then.
+ *
+ * Takes the arguments of the `AggregateTimer` constructor, i.e. the name, and
+ * optionally `every_calls` and `period`, and expands to a function-local
+ * static `AggregateTimer`, which prints at the end of the program, and a
+ * `ScopedAggregate` on it. Unlike the profiling macros, this is always
+ * enabled, like a `ScopedTimer`.
+ */
+#define EFFORTLESS_AGGREGATE_SCOPE(...)                               \
+  EFFORTLESS_AGGREGATE_SCOPE_IMPL(                                    \
+    EFFORTLESS_CONCAT(effortless_aggregate_timer_, __LINE__),         \
+    EFFORTLESS_CONCAT(effortless_aggregate_scope_, __LINE__), __VA_ARGS__)
+#define EFFORTLESS_AGGREGATE_SCOPE_IMPL(timer, scope, ...)            \
+  static ::effortless::AggregateTimer timer(__VA_ARGS__);             \
+  const ::effortless::ScopedAggregate scope(timer)
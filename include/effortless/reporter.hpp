@@ -0,0 +1,219 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "effortless/interval_statistic.hpp"
+#include "effortless/logger.hpp"
+#include "effortless/profile.hpp"
+#include "effortless/statistic.hpp"
+#include "effortless/timer.hpp"
+
+namespace effortless {
+
+/*
+ * Writes periodic reports of what happened since the last report.
+ *
+ * Every period, a background thread started with `start(period)` snapshots
+ * all added interval statistics and timers, and optionally all registered
+ * `ProfileTimer`s, and logs the count, mean and p99 of each over the last
+ * interval, instead of the totals of the whole run. Reports go to a `Logger`,
+ * or to a file when constructed with a path, and can also be taken manually
+ * with `report()`, or as values with `snapshot()`.
+ *
+ * The reporter never reads a statistic while it is written. It takes its
+ * snapshots as a consumer of an `IntervalStatistic`, so it sees every sample
+ * exactly once, also next to a `Watcher`. Timers feed their timings into
+ * their intervals, see `BasicTimer::enableIntervals()`, which adding a timer
+ * enables. Plain statistics are not synchronized, so report an
+ * `IntervalStatistic` in their place. The timed threads keep updating their
+ * statistics and timers as usual.
+ */
+class Reporter {
+ public:
+  /// Values of one statistic over one interval.
+  struct Report {
+    std::string name;
+    int count;
+    Scalar mean;
+    Scalar p99;
+    Scalar seconds;
+    std::string unit;
+
+    /// Samples per second in this interval.
+    [[nodiscard]] Scalar rate() const {
+      return seconds > 0.0 ? count / seconds : 0.0;
+    }
+  };
+
+  Reporter(const std::string &name = "Reporter")
+    : logger_(std::make_unique<Logger>(name)) {}
+  Reporter(const std::string &name, const fs::path &file)
+    : logger_(std::make_unique<FileLogger>(name, file)) {}
+  Reporter(const Reporter &) = delete;
+  ~Reporter() {
+    stop();
+    for (const Entry &entry : entries_)
+      entry.statistic->unsubscribe(entry.consumer);
+    // Only unsubscribe from registered timers which still exist.
+    for (ProfileTimer *timer : TimerRegistry::instance().timers()) {
+      const Entry *entry = registeredEntry(timer);
+      if (entry) entry->statistic->unsubscribe(entry->consumer);
+    }
+  }
+
+  /// Reports each interval of a statistic, which must outlive the reporter,
+  /// with its values multiplied by `scale`. The p99 needs a reservoir.
+  void add(IntervalStatistic &statistic, const Scalar scale = 1.0,
+           const std::string &unit = "") {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back({&statistic, statistic.subscribe(), scale, unit});
+  }
+
+  /// Reports each interval of a timer, which must outlive the reporter, in
+  /// milliseconds. Enables the intervals of the timer, from its next timing.
+  template<typename Clock> void add(BasicTimer<Clock> &timer) {
+    add(timer.enableIntervals(), 1000.0, "ms");
+  }
+
+  /// Also reports all timers registered in the `TimerRegistry`, enabling
+  /// their intervals on the next snapshot.
+  void addRegistered(const bool enable = true) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    registered_ = enable;
+  }
+
+  /// Returns the values of all statistics since the last snapshot.
+  std::vector<Report> snapshot() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Report> reports;
+    for (const Entry &entry : entries_)
+      reports.push_back(reportInterval(entry));
+
+    if (registered_) {
+      // Drops the entries of destroyed timers, whose address may be reused.
+      std::unordered_map<const ProfileTimer *, Entry> entries;
+      for (ProfileTimer *timer : TimerRegistry::instance().timers()) {
+        const Entry *entry = registeredEntry(timer);
+        if (entry) {
+          entries.emplace(timer, *entry);
+        } else {
+          IntervalStatistic &intervals = timer->enableIntervals();
+          entries.emplace(
+            timer, Entry{&intervals, intervals.subscribe(), 1000.0, "ms"});
+        }
+        reports.push_back(reportInterval(entries.at(timer)));
+      }
+      registered_entries_ = std::move(entries);
+    }
+    return reports;
+  }
+
+  /// Logs the values of all statistics since the last report.
+  void report() {
+    const std::vector<Report> reports = snapshot();
+    std::ostringstream ss;
+    ss.precision(3);
+    for (const Report &report : reports) {
+      ss << std::left << std::setw(24) << report.name << std::right
+         << std::setw(8) << report.count << " in " << std::setw(6)
+         << report.seconds << "s  mean: " << std::setw(8) << report.mean;
+      if (!std::isnan(report.p99))
+        ss << "  p99: " << std::setw(8) << report.p99;
+      if (!report.unit.empty()) ss << " " << report.unit;
+      ss << '\n';
+    }
+    if (reports.empty()) return;
+    *logger_ << "Interval report\n" << ss.str() << std::flush;
+  }
+
+  /// Starts reporting in a background thread every `period` seconds.
+  void start(const Scalar period = 1.0) {
+    stop();
+    {
+      const std::lock_guard<std::mutex> lock(thread_mutex_);
+      running_ = true;
+    }
+    const std::chrono::nanoseconds wait((long long)(1e9 * period));
+    thread_ = std::thread([this, wait]() {
+      std::unique_lock<std::mutex> lock(thread_mutex_);
+      std::chrono::steady_clock::time_point t_next =
+        std::chrono::steady_clock::now();
+      while (running_) {
+        t_next += wait;
+        if (wakeup_.wait_until(lock, t_next, [this]() { return !running_; }))
+          break;
+        report();
+      }
+    });
+  }
+
+  /// Stops the background thread, if running.
+  void stop() {
+    {
+      const std::lock_guard<std::mutex> lock(thread_mutex_);
+      running_ = false;
+    }
+    wakeup_.notify_all();
+    if (thread_.joinable()) thread_.join();
+  }
+
+ private:
+  struct Entry {
+    IntervalStatistic *statistic;
+    IntervalStatistic::Consumer consumer;
+    Scalar scale;
+    std::string unit;
+  };
+
+  /// Returns the entry of a registered timer, unless it belongs to a
+  /// destroyed timer at the same address, whose intervals differ.
+  const Entry *registeredEntry(const ProfileTimer *timer) const {
+    const auto it = registered_entries_.find(timer);
+    if (it == registered_entries_.end() ||
+        it->second.statistic != timer->intervals())
+      return nullptr;
+    return &it->second;
+  }
+
+  static Report reportInterval(const Entry &entry) {
+    const IntervalStatistic::Interval interval =
+      entry.statistic->snapshotAndRotate(entry.consumer);
+    const Statistic &statistic = interval.statistic;
+    const int n = statistic.count();
+    const Scalar p99 = statistic.reservoir() && n > 0
+                         ? entry.scale * statistic.reservoir()->quantile(0.99)
+                         : std::numeric_limits<Scalar>::quiet_NaN();
+    return {statistic.name(),
+            n,
+            n > 0 ? entry.scale * statistic.mean() : 0.0,
+            p99,
+            interval.seconds,
+            entry.unit};
+  }
+
+  std::unique_ptr<Logger> logger_;
+  std::mutex mutex_;
+  std::vector<Entry> entries_;
+  bool registered_{false};
+  std::unordered_map<const ProfileTimer *, Entry> registered_entries_;
+
+  std::thread thread_;
+  std::mutex thread_mutex_;
+  std::condition_variable wakeup_;
+  bool running_{false};
+};
+
+}  // namespace effortless
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace effortless {
+
+using Scalar = double;
+
+/*
+ * Fixed-size uniform random sample of a stream.
+ *
+ * Keeps `capacity()` samples such that every sample of the stream is equally
+ * likely to be kept, e.g. to plot representative raw samples of a week-long
+ * run. Uses Algorithm L, which draws how many samples to skip until the next
+ * replacement, so adding a sample typically costs a single comparison.
+ *
+ * Each kept sample carries the uniform random key that selected it, the
+ * reservoir being the samples with the smallest keys. This makes `merge()`
+ * exact: the union of two reservoirs is reduced to its smallest keys, giving a
+ * uniform sample of both streams, e.g. across threads.
+ */
+class Reservoir {
+ public:
+  Reservoir(const std::size_t capacity = 1024, const std::uint64_t seed = 0)
+    : capacity_(std::max<std::size_t>(capacity, 1)),
+      state_(seed ? seed : nextSeed()) {
+    samples_.reserve(capacity_);
+  }
+
+  void add(const Scalar in) {
+    ++n_;
+    if (n_ < next_) return;
+
+    if (samples_.size() < capacity_) {
+      samples_.emplace_back(uniform(), in);
+      std::push_heap(samples_.begin(), samples_.end());
+    } else {
+      // The accepted sample has a key uniform below the current threshold.
+      std::pop_heap(samples_.begin(), samples_.end());
+      samples_.back() = {threshold() * uniform(), in};
+      std::push_heap(samples_.begin(), samples_.end());
+    }
+    skip();
+  }
+
+  Reservoir &operator<<(const Scalar in) {
+    add(in);
+    return *this;
+  }
+
+  /// Merges `rhs` such that the result is a uniform sample of both streams.
+  Reservoir &merge(const Reservoir &rhs) {
+    samples_.insert(samples_.end(), rhs.samples_.begin(), rhs.samples_.end());
+    if (samples_.size() > capacity_) {
+      std::nth_element(samples_.begin(),
+                       samples_.begin() + (std::ptrdiff_t)capacity_ - 1,
+                       samples_.end());
+      samples_.resize(capacity_);
+    }
+    std::make_heap(samples_.begin(), samples_.end());
+    n_ += rhs.n_;
+    next_ = n_ + 1;
+    skip();
+    return *this;
+  }
+
+  Reservoir &operator+=(const Reservoir &rhs) { return merge(rhs); }
+
+  /// Returns the kept samples in unspecified order.
+  [[nodiscard]] std::vector<Scalar> samples() const {
+    std::vector<Scalar> values;
+    values.reserve(samples_.size());
+    for (const Sample &sample : samples_) values.push_back(sample.second);
+    return values;
+  }
+
+  /// Estimates the `p`-quantile, with `p` in [0, 1], from the kept samples.
+  [[nodiscard]] Scalar quantile(const Scalar p) const {
+    if (samples_.empty()) return std::numeric_limits<Scalar>::quiet_NaN();
+    std::vector<Scalar> values = samples();
+    const std::size_t k = std::min(
+      values.size() - 1,
+      (std::size_t)(std::max(p, 0.0) * (Scalar)(values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + (std::ptrdiff_t)k,
+                     values.end());
+    return values[k];
+  }
+
+  [[nodiscard]] std::size_t size() const { return samples_.size(); }
+  [[nodiscard]] std::size_t capacity() const { return capacity_; }
+  /// Number of samples seen by the reservoir.
+  [[nodiscard]] std::uint64_t count() const { return n_; }
+
+  void reset() {
+    samples_.clear();
+    n_ = 0;
+    next_ = 1;
+  }
+
+  /// Writes the kept samples as CSV with a header line, in unspecified order.
+  void writeCsv(std::ostream &os, const std::string &header = "value") const {
+    const std::streamsize prec = os.precision();
+    os.precision(std::numeric_limits<Scalar>::max_digits10);
+    os << header << '\n';
+    for (const Sample &sample : samples_) os << sample.second << '\n';
+    os.precision(prec);
+  }
+
+  /// Writes the kept samples as CSV to `file`, returns false on failure.
+  bool writeCsv(const std::string &file,
+                const std::string &header = "value") const {
+    std::ofstream ofs(file);
+    if (!ofs.is_open()) return false;
+    writeCsv(ofs, header);
+    return ofs.good();
+  }
+
+ private:
+  using Sample = std::pair<Scalar, Scalar>;
+
+  [[nodiscard]] Scalar threshold() const {
+    return samples_.size() < capacity_ ? 1.0 : samples_.front().first;
+  }
+
+  /// Draws the index of the next sample to accept.
+  void skip() {
+    if (samples_.size() < capacity_) {
+      next_ = n_ + 1;
+      return;
+    }
+    const Scalar w = threshold();
+    const Scalar gap =
+      w < 1.0 ? std::floor(std::log(uniform()) / std::log1p(-w)) : 0.0;
+    next_ = n_ + 1 + (std::uint64_t)std::min(gap, 1e18);
+  }
+
+  /// Uniform random number in (0, 1) from a splitmix64 generator.
+  Scalar uniform() {
+    return ((Scalar)(mix(state_ += 0x9e3779b97f4a7c15ULL) >> 11) + 0.5) *
+           0x1.0p-53;
+  }
+
+  static std::uint64_t mix(std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  /// Distinct seeds per reservoir, so merged reservoirs are independent.
+  static std::uint64_t nextSeed() {
+    static std::atomic<std::uint64_t> counter{1};
+    return mix(counter.fetch_add(1, std::memory_order_relaxed));
+  }
+
+  std::size_t capacity_;
+  std::uint64_t state_;
+  std::uint64_t n_{0};
+  std::uint64_t next_{1};
+  std::vector<Sample> samples_;
+};
+
+}  // namespace effortless
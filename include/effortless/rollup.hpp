@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "effortless/compact_statistic.hpp"
+
+namespace effortless {
+
+/*
+ * Round-robin rollup of a statistic over time, like an RRD.
+ *
+ * Keeps rings of per-bucket `CompactStatistic`s at several resolutions, e.g.
+ * the last hour at 1 s and the last day at 1 min, in bounded memory. Samples
+ * are added in O(1) to the current bucket of the finest level. When a bucket
+ * completes, it is merged into the bucket of the next coarser level, so the
+ * coarser levels are downsampled exactly and fill up as finer buckets
+ * complete. Each resolution should be a multiple of the previous one.
+ *
+ * Any level can be exported as a time series with wall-clock timestamps.
+ */
+class Rollup {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Level {
+    Scalar resolution;
+    std::size_t buckets;
+  };
+
+  struct Bucket {
+    Scalar time;
+    CompactStatistic statistic;
+  };
+
+  Rollup(const std::string_view name = "Rollup",
+         const std::vector<Level> &levels = {{1.0, 3600}, {60.0, 1440}})
+    : name_(NameTable::intern(name)),
+      t_start_(Clock::now()),
+      t_start_wall_(std::chrono::system_clock::now()) {
+    for (const Level &level : levels) {
+      Ring ring;
+      ring.resolution = std::max<std::int64_t>(
+        (std::int64_t)std::llround(1e9 * level.resolution), 1);
+      ring.buckets.assign(std::max<std::size_t>(level.buckets, 1),
+                          CompactStatistic(name_));
+      rings_.push_back(std::move(ring));
+    }
+  }
+
+  void add(const Scalar in) { add(in, Clock::now()); }
+
+  /// Adds a sample at time `t`, samples older than the current bucket are
+  /// counted in the current bucket.
+  void add(const Scalar in, const Clock::time_point t) {
+    if (rings_.empty()) return;
+    const std::int64_t bucket = bucketAt(0, t);
+    advance(0, bucket);
+    Ring &ring = rings_[0];
+    ring.buckets[index(ring, std::max(bucket, ring.current))] << in;
+  }
+
+  [[nodiscard]] std::size_t levels() const { return rings_.size(); }
+  [[nodiscard]] Scalar resolution(const std::size_t level) const {
+    return 1e-9 * (Scalar)rings_[level].resolution;
+  }
+
+  /// Returns the buckets of `level` from oldest to newest, with their start
+  /// time in seconds since the epoch. Empty buckets have a count of zero.
+  [[nodiscard]] std::vector<Bucket> series(const std::size_t level) const {
+    const Ring &ring = rings_[level];
+    std::vector<Bucket> series;
+    if (ring.current < 0) return series;
+
+    const std::int64_t first = std::max<std::int64_t>(
+      ring.current - (std::int64_t)ring.buckets.size() + 1, 0);
+    const Scalar t_start =
+      1e-9 * (Scalar)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               t_start_wall_.time_since_epoch())
+               .count();
+    series.reserve((std::size_t)(ring.current - first + 1));
+    for (std::int64_t bucket = first; bucket <= ring.current; ++bucket)
+      series.push_back({t_start + 1e-9 * (Scalar)(bucket * ring.resolution),
+                        ring.buckets[index(ring, bucket)]});
+    return series;
+  }
+
+  /// Writes `level` as CSV time series.
+  void writeCsv(std::ostream &os, const std::size_t level) const {
+    const std::streamsize prec = os.precision();
+    os << "time,count,mean,std,min,max\n";
+    for (const Bucket &bucket : series(level)) {
+      const CompactStatistic &s = bucket.statistic;
+      os.precision(std::numeric_limits<Scalar>::max_digits10);
+      os << bucket.time << ',' << s.count();
+      os.precision(prec);
+      if (s.count())
+        os << ',' << s.mean() << ',' << s.std() << ',' << s.min() << ','
+           << s.max() << '\n';
+      else
+        os << ",,,,\n";
+    }
+  }
+
+  [[nodiscard]] const std::string &name() const {
+    return NameTable::name(name_);
+  }
+
+ private:
+  struct Ring {
+    std::int64_t resolution;
+    std::int64_t current{-1};
+    std::vector<CompactStatistic> buckets;
+  };
+
+  [[nodiscard]] std::int64_t bucketAt(const std::size_t level,
+                                      const Clock::time_point t) const {
+    const std::int64_t ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(t - t_start_)
+        .count();
+    return std::max<std::int64_t>(ns, 0) / rings_[level].resolution;
+  }
+
+  static std::size_t index(const Ring &ring, const std::int64_t bucket) {
+    return (std::size_t)bucket % ring.buckets.size();
+  }
+
+  /// Moves the current bucket of `level` forward, completing the current one.
+  void advance(const std::size_t level, const std::int64_t bucket) {
+    Ring &ring = rings_[level];
+    if (bucket <= ring.current) return;
+
+    if (ring.current >= 0 && level + 1 < rings_.size()) {
+      const std::int64_t parent =
+        ring.current * ring.resolution / rings_[level + 1].resolution;
+      advance(level + 1, parent);
+      Ring &coarse = rings_[level + 1];
+      coarse.buckets[index(coarse, parent)].merge(
+        ring.buckets[index(ring, ring.current)]);
+    }
+
+    const std::int64_t size = (std::int64_t)ring.buckets.size();
+    for (std::int64_t b = std::max(ring.current + 1, bucket - size + 1);
+         b <= bucket; ++b)
+      ring.buckets[index(ring, b)] = CompactStatistic(name_);
+    ring.current = bucket;
+  }
+
+  NameId name_;
+  Clock::time_point t_start_;
+  std::chrono::system_clock::time_point t_start_wall_;
+  std::vector<Ring> rings_;
+};
+
+}  // namespace effortless
@@ -4,7 +4,13 @@
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
+
+#include "effortless/change_detector.hpp"
+#include "effortless/reservoir.hpp"
 
 namespace effortless {
 
@@ -13,7 +19,7 @@ using Scalar = double;
 class Statistic {
  public:
   Statistic(const std::string &name = "Statistic") : name_(name) {}
-  Statistic(const Statistic &rhs) = default;
+  Statistic(const Statistic &rhs) : name_(rhs.name_) { *this = rhs; }
   Statistic &operator=(const Statistic &rhs) {
     n_ = rhs.n_;
     last_ = rhs.last_;
@@ -21,6 +27,17 @@ class Statistic {
     max_ = rhs.max_;
     sum_ = rhs.sum_;
     ssum_ = rhs.ssum_;
+    moments_ = rhs.moments_;
+    mean_ = rhs.mean_;
+    m2_ = rhs.m2_;
+    m3_ = rhs.m3_;
+    m4_ = rhs.m4_;
+    reservoir_ =
+      rhs.reservoir_ ? std::make_unique<Reservoir>(*rhs.reservoir_) : nullptr;
+    sampled_ = rhs.sampled_;
+    detector_ = rhs.detector_
+                  ? std::make_unique<ChangeDetector>(*rhs.detector_)
+                  : nullptr;
     return *this;
   }
 
@@ -33,12 +50,92 @@ class Statistic {
     last_ = in;
     min_ = std::min(in, min_);
     max_ = std::max(in, max_);
+    if (moments_) addMoments(in);
+    if (reservoir_ && sampled_) reservoir_->add(in);
+    if (detector_) detector_->add(in);
 
     return mean();
   }
 
   Scalar add(const Scalar in) { return operator<<(in); }
 
+  /// Merges the samples of `rhs` into this statistic, e.g. across threads.
+  /// Higher moments are only kept if both sides track them, as they cannot be
+  /// recovered for the samples of a side without. Merging with a statistic
+  /// without moments therefore turns `hasMoments()` false, and skewness and
+  /// kurtosis read as zero from then on.
+  ///
+  /// The configuration of this statistic is kept, also if it is empty: a
+  /// reservoir of `rhs` is only merged into a reservoir of this statistic, and
+  /// the change-point detector is neither merged nor copied. If this statistic
+  /// keeps a reservoir, but `rhs` has no valid one, the reservoir cannot
+  /// represent the merged samples without bias. It is then cleared, and
+  /// `reservoir()` returns null, so quantiles are unavailable, until `reset()`.
+  Statistic &merge(const Statistic &rhs) {
+    if (rhs.n_ < 1) return *this;
+
+    // Also exact for an empty statistic, whose moments are zero.
+    if (moments_ && rhs.moments_)
+      mergeMoments(rhs);
+    else
+      moments_ = false;
+
+    if (reservoir_ && sampled_) {
+      if (rhs.reservoir()) {
+        reservoir_->merge(*rhs.reservoir_);
+      } else {
+        reservoir_->reset();
+        sampled_ = false;
+      }
+    }
+
+    min_ = n_ < 1 ? rhs.min_ : std::min(rhs.min_, min_);
+    max_ = n_ < 1 ? rhs.max_ : std::max(rhs.max_, max_);
+    n_ += rhs.n_;
+    sum_ += rhs.sum_;
+    ssum_ += rhs.ssum_;
+    last_ = rhs.last_;
+    return *this;
+  }
+
+  Statistic &operator+=(const Statistic &rhs) { return merge(rhs); }
+
+  /// Enables tracking of third and fourth central moments. Throws once samples
+  /// were added, as the moments would miss them, `reset()` first.
+  void enableMoments(const bool enable = true) {
+    if (enable && n_ > 0)
+      throw std::logic_error(std::string("Statistic '") + name_ +
+                             "': enable moments before adding samples");
+    moments_ = enable;
+    resetMoments();
+  }
+
+  /// Keeps a uniform random subset of `capacity` raw samples.
+  /// Should be enabled before the first sample, to cover all samples.
+  void enableReservoir(const std::size_t capacity = 1024,
+                       const std::uint64_t seed = 0) {
+    reservoir_ = std::make_unique<Reservoir>(capacity, seed);
+    sampled_ = true;
+  }
+
+  /// Attaches a change-point detector to the samples, which is kept across
+  /// `reset()`. The callback is called when the level of the samples shifts.
+  void detectChanges(const ChangeDetectorSettings &settings = {},
+                     ChangeDetector::Callback callback = {}) {
+    detector_ = std::make_unique<ChangeDetector>(settings, std::move(callback));
+  }
+
+  /// The change-point detector, if attached.
+  [[nodiscard]] const ChangeDetector *changes() const {
+    return detector_.get();
+  }
+  [[nodiscard]] ChangeDetector *changes() { return detector_.get(); }
+
+  /// The reservoir of raw samples, if enabled and valid, see `merge()`.
+  [[nodiscard]] const Reservoir *reservoir() const {
+    return sampled_ ? reservoir_.get() : nullptr;
+  }
+
   [[nodiscard]] Scalar operator()() const { return mean(); }
   [[nodiscard]] operator double() const { return (double)mean(); }
   [[nodiscard]] operator float() const { return (float)mean(); }
@@ -56,6 +153,26 @@ class Statistic {
   [[nodiscard]] Scalar max() const { return max_; }
   [[nodiscard]] Scalar sum() const { return sum_; }
 
+  /// True if higher moments are tracked, which a merge with a statistic
+  /// without them turns off, see `merge()`.
+  [[nodiscard]] bool hasMoments() const { return moments_; }
+  /// Sample skewness, requires `enableMoments()`.
+  [[nodiscard]] Scalar skewness() const {
+    if (!moments_ || n_ < 2 || m2_ <= 0.0) return 0.0;
+    return std::sqrt((Scalar)n_) * m3_ / std::pow(m2_, 1.5);
+  }
+  /// Sample excess kurtosis (0 for a normal distribution), requires
+  /// `enableMoments()`.
+  [[nodiscard]] Scalar kurtosis() const {
+    if (!moments_ || n_ < 2 || m2_ <= 0.0) return 0.0;
+    return (Scalar)n_ * m4_ / (m2_ * m2_) - 3.0;
+  }
+  /// True if the excess kurtosis indicates a markedly heavy-tailed
+  /// distribution.
+  [[nodiscard]] bool heavyTailed() const {
+    return kurtosis() > HEAVY_TAIL_KURTOSIS;
+  }
+
   [[nodiscard]] const std::string &name() const { return name_; }
 
   void reset() {
@@ -65,6 +182,18 @@ class Statistic {
     last_ = 0.0;
     min_ = std::numeric_limits<Scalar>::max();
     max_ = std::numeric_limits<Scalar>::min();
+    resetMoments();
+    if (reservoir_) reservoir_->reset();
+    sampled_ = true;
+  }
+
+  /// Returns the statistic since the last snapshot and starts a fresh one,
+  /// without a window for samples between reading and resetting.
+  /// For a writer in another thread, use `IntervalStatistic`.
+  Statistic snapshotAndRotate() {
+    Statistic snapshot(*this);
+    reset();
+    return snapshot;
   }
 
   friend std::ostream &operator<<(std::ostream &os, const Statistic &s) {
@@ -77,13 +206,67 @@ class Statistic {
     os << std::left << std::setw(5) << s.mean() << "|";
     os << std::left << std::setw(5) << s.std() << "  [min|max:  ";
     os << std::left << std::setw(5) << s.min() << "|";
-    os << std::left << std::setw(5) << s.max() << "]" << std::endl;
+    os << std::left << std::setw(5) << s.max() << "]";
+    if (s.moments_) {
+      os << "  skew|kurt:  " << std::left << std::setw(5) << s.skewness()
+         << "|" << std::left << std::setw(5) << s.kurtosis();
+    }
+    os << std::endl;
 
     os.precision(prec);
     return os;
   }
 
  protected:
+  /// Excess kurtosis above which a distribution is reported as heavy-tailed.
+  static constexpr Scalar HEAVY_TAIL_KURTOSIS = 3.0;
+
+  void addMoments(const Scalar in) {
+    // Incremental central moments (Terriberry), with n_ already incremented.
+    const Scalar n = (Scalar)n_;
+    const Scalar delta = in - mean_;
+    const Scalar delta_n = delta / n;
+    const Scalar delta_n2 = delta_n * delta_n;
+    const Scalar term = delta * delta_n * (n - 1.0);
+    mean_ += delta_n;
+    m4_ += term * delta_n2 * (n * n - 3.0 * n + 3.0) + 6.0 * delta_n2 * m2_ -
+           4.0 * delta_n * m3_;
+    m3_ += term * delta_n * (n - 2.0) - 3.0 * delta_n * m2_;
+    m2_ += term;
+  }
+
+  void mergeMoments(const Statistic &rhs) {
+    // Pairwise combination of central moments (Pebay), before adding counts.
+    const Scalar na = (Scalar)n_;
+    const Scalar nb = (Scalar)rhs.n_;
+    const Scalar n = na + nb;
+    const Scalar delta = rhs.mean_ - mean_;
+    const Scalar delta2 = delta * delta;
+    const Scalar delta3 = delta2 * delta;
+    const Scalar delta4 = delta2 * delta2;
+
+    const Scalar m2 = m2_ + rhs.m2_ + delta2 * na * nb / n;
+    const Scalar m3 = m3_ + rhs.m3_ + delta3 * na * nb * (na - nb) / (n * n) +
+                      3.0 * delta * (na * rhs.m2_ - nb * m2_) / n;
+    const Scalar m4 =
+      m4_ + rhs.m4_ +
+      delta4 * na * nb * (na * na - na * nb + nb * nb) / (n * n * n) +
+      6.0 * delta2 * (na * na * rhs.m2_ + nb * nb * m2_) / (n * n) +
+      4.0 * delta * (na * rhs.m3_ - nb * m3_) / n;
+
+    mean_ += delta * nb / n;
+    m2_ = m2;
+    m3_ = m3;
+    m4_ = m4;
+  }
+
+  void resetMoments() {
+    mean_ = 0.0;
+    m2_ = 0.0;
+    m3_ = 0.0;
+    m4_ = 0.0;
+  }
+
   const std::string name_;
   int n_{0};
   Scalar sum_{0.0};
@@ -91,6 +274,19 @@ class Statistic {
   Scalar last_{0.0};
   Scalar min_{std::numeric_limits<Scalar>::max()};
   Scalar max_{std::numeric_limits<Scalar>::min()};
+
+  bool moments_{false};
+  Scalar mean_{0.0};
+  Scalar m2_{0.0};
+  Scalar m3_{0.0};
+  Scalar m4_{0.0};
+
+  /// Allocated when enabled, like the detector.
+  std::unique_ptr<Reservoir> reservoir_;
+  /// False once merged with samples the reservoir does not represent.
+  bool sampled_{true};
+  /// Allocated when attached, as it is large.
+  std::unique_ptr<ChangeDetector> detector_;
 };
 
 }  // namespace effortless
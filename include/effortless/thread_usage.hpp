@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+
+#include <sys/resource.h>
+
+#include "effortless/statistic.hpp"
+
+namespace effortless {
+
+/// Resources used by the calling thread so far.
+struct ThreadUsage {
+  /// CPU time in seconds.
+  Scalar cpu{0.0};
+  std::int64_t voluntary_switches{0};
+  std::int64_t involuntary_switches{0};
+  std::int64_t minor_faults{0};
+  std::int64_t major_faults{0};
+
+  static ThreadUsage now() {
+    ThreadUsage usage;
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec t;
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t))
+      usage.cpu = (Scalar)t.tv_sec + 1e-9 * (Scalar)t.tv_nsec;
+#endif
+#if defined(RUSAGE_THREAD)
+    rusage r;
+    if (!getrusage(RUSAGE_THREAD, &r)) {
+      usage.voluntary_switches = r.ru_nvcsw;
+      usage.involuntary_switches = r.ru_nivcsw;
+      usage.minor_faults = r.ru_minflt;
+      usage.major_faults = r.ru_majflt;
+    }
+#endif
+    return usage;
+  }
+
+  ThreadUsage operator-(const ThreadUsage &rhs) const {
+    return {cpu - rhs.cpu, voluntary_switches - rhs.voluntary_switches,
+            involuntary_switches - rhs.involuntary_switches,
+            minor_faults - rhs.minor_faults, major_faults - rhs.major_faults};
+  }
+
+  ThreadUsage &operator+=(const ThreadUsage &rhs) {
+    cpu += rhs.cpu;
+    voluntary_switches += rhs.voluntary_switches;
+    involuntary_switches += rhs.involuntary_switches;
+    minor_faults += rhs.minor_faults;
+    major_faults += rhs.major_faults;
+    return *this;
+  }
+};
+
+/*
+ * Breaks down timed intervals into on-CPU and off-CPU time.
+ *
+ * A slow interval may be slow code, or a thread that was descheduled or
+ * blocked. This samples the thread CPU time and `getrusage(RUSAGE_THREAD)` at
+ * the start and stop of each interval, keeping statistics of the CPU time and
+ * the wait time, i.e. wall time not spent on the CPU, as well as the totals of
+ * context switches and page faults. Costs two system calls per sample, so it
+ * is meant to diagnose rather than to stay enabled.
+ */
+class UsageStatistic {
+ public:
+  /// Starts an interval on the calling thread.
+  void start() { start_ = ThreadUsage::now(); }
+
+  /// Stops the interval of `wall` seconds and starts the next one.
+  void stop(const Scalar wall) {
+    const ThreadUsage end = ThreadUsage::now();
+    const ThreadUsage delta = end - start_;
+    start_ = end;
+    cpu_ << delta.cpu;
+    wait_ << std::max(wall - delta.cpu, 0.0);
+    total_ += delta;
+  }
+
+  UsageStatistic &merge(const UsageStatistic &rhs) {
+    cpu_.merge(rhs.cpu_);
+    wait_.merge(rhs.wait_);
+    total_ += rhs.total_;
+    return *this;
+  }
+
+  /// CPU time per interval.
+  [[nodiscard]] const Statistic &cpu() const { return cpu_; }
+  /// Wall time not spent on the CPU per interval.
+  [[nodiscard]] const Statistic &wait() const { return wait_; }
+  /// Summed CPU time, context switches, and page faults of all intervals.
+  [[nodiscard]] const ThreadUsage &total() const { return total_; }
+  [[nodiscard]] int count() const { return cpu_.count(); }
+
+  void reset() {
+    cpu_.reset();
+    wait_.reset();
+    total_ = ThreadUsage();
+  }
+
+ private:
+  ThreadUsage start_;
+  ThreadUsage total_;
+  Statistic cpu_{"CPU"};
+  Statistic wait_{"Wait"};
+};
+
+}  // namespace effortless
@@ -3,28 +3,31 @@
 #include <chrono>
 #include <functional>
 
+#include "effortless/clock.hpp"
+
 namespace effortless {
 
-template<typename T> class Throttler {
+template<typename T, typename Clock = SteadyClock> class Throttler {
  public:
   Throttler(T& obj, const double period_seconds)
     : Throttler(obj, std::chrono::microseconds((int)(1e6 * period_seconds))) {}
   Throttler(T& obj, const std::chrono::microseconds period)
-    : obj(obj), period(period) {}
+    : obj(obj), period(1e-6 * (double)period.count()) {}
 
   template<class F, class... Args> void operator()(F&& f, const Args&... args) {
-    const std::chrono::steady_clock::time_point t_now =
-      std::chrono::steady_clock::now();
-    if ((t_now - t_last) > period) {
+    const typename Clock::time_point t_now = Clock::now();
+    if (!started || Clock::seconds(t_last, t_now) > period) {
       std::invoke(f, obj, args...);
       t_last = t_now;
+      started = true;
     }
   }
 
  private:
   T& obj;
-  const std::chrono::microseconds period;
-  std::chrono::steady_clock::time_point t_last;
+  const double period;
+  typename Clock::time_point t_last{};
+  bool started{false};
 };
 
 }  // namespace effortless
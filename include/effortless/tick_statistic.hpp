@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "effortless/statistic.hpp"
+
+namespace effortless {
+
+/*
+ * Statistic of unsigned integer samples, like clock ticks, kept exactly.
+ *
+ * Adding a sample only does integer arithmetic on the count, the sum, the sum
+ * of squares, the minimum and the maximum, without any conversion or check of
+ * floating point values, so every update is exact and the result does not
+ * depend on the order of samples or merges. Floating point values, like the
+ * mean and the standard deviation, are only computed when queried.
+ *
+ * The sum of squares is kept in 128 bits, where the compiler supports it, and
+ * as `long double` otherwise. With 128 bits, the standard deviation is
+ * computed from the exact integer variance, avoiding the cancellation of
+ * large sums of squares in floating point.
+ */
+class TickStatistic {
+ public:
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 Square;
+#else
+  typedef long double Square;
+#endif
+
+  TickStatistic(const std::string &name = "TickStatistic") : name_(name) {}
+
+  void add(const std::uint64_t ticks) {
+    ++n_;
+    sum_ += ticks;
+    ssum_ += (Square)ticks * ticks;
+    last_ = ticks;
+    min_ = std::min(ticks, min_);
+    max_ = std::max(ticks, max_);
+  }
+
+  TickStatistic &operator<<(const std::uint64_t ticks) {
+    add(ticks);
+    return *this;
+  }
+
+  /// Merges the samples of `rhs` into this statistic, e.g. across threads.
+  TickStatistic &merge(const TickStatistic &rhs) {
+    if (rhs.n_ < 1) return *this;
+    n_ += rhs.n_;
+    sum_ += rhs.sum_;
+    ssum_ += rhs.ssum_;
+    last_ = rhs.last_;
+    min_ = std::min(rhs.min_, min_);
+    max_ = std::max(rhs.max_, max_);
+    return *this;
+  }
+
+  TickStatistic &operator+=(const TickStatistic &rhs) { return merge(rhs); }
+
+  [[nodiscard]] std::uint64_t count() const { return n_; }
+  [[nodiscard]] std::uint64_t sum() const { return sum_; }
+  [[nodiscard]] Square squares() const { return ssum_; }
+  [[nodiscard]] std::uint64_t last() const { return last_; }
+  [[nodiscard]] std::uint64_t min() const { return n_ ? min_ : 0; }
+  [[nodiscard]] std::uint64_t max() const { return max_; }
+
+  [[nodiscard]] Scalar mean() const {
+    return n_ ? (Scalar)sum_ / (Scalar)n_ : 0.0;
+  }
+
+  [[nodiscard]] Scalar std() const {
+    if (!n_) return 0.0;
+    const long double n = (long double)n_;
+#if defined(__SIZEOF_INT128__)
+    // n^2 times the variance is exact in integers, unless n * ssum overflows.
+    if (ssum_ <= ~(Square)0 / n_) {
+      const Square scaled = n_ * ssum_ - (Square)sum_ * sum_;
+      return (Scalar)(std::sqrt((long double)scaled) / n);
+    }
+#endif
+    const long double mean = (long double)sum_ / n;
+    const long double variance = (long double)ssum_ / n - mean * mean;
+    return variance > 0.0L ? (Scalar)std::sqrt(variance) : 0.0;
+  }
+
+  [[nodiscard]] const std::string &name() const { return name_; }
+
+  void reset() {
+    n_ = 0;
+    sum_ = 0;
+    ssum_ = 0;
+    last_ = 0;
+    min_ = std::numeric_limits<std::uint64_t>::max();
+    max_ = 0;
+  }
+
+ private:
+  const std::string name_;
+  std::uint64_t n_{0};
+  std::uint64_t sum_{0};
+  Square ssum_{0};
+  std::uint64_t last_{0};
+  std::uint64_t min_{std::numeric_limits<std::uint64_t>::max()};
+  std::uint64_t max_{0};
+};
+
+}  // namespace effortless
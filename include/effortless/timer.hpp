@@ -1,17 +1,64 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <regex>
 #include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "effortless/clock.hpp"
+#include "effortless/covariance_statistic.hpp"
+#include "effortless/exemplars.hpp"
+#include "effortless/interval_statistic.hpp"
 #include "effortless/logger.hpp"
+#include "effortless/perf_counters.hpp"
 #include "effortless/statistic.hpp"
+#include "effortless/thread_usage.hpp"
+#include "effortless/tick_statistic.hpp"
+#include "effortless/trace.hpp"
 
 namespace effortless {
 
 using Scalar = double;
 
+template<typename Clock> class BasicTimer;
+template<typename Clock> class BasicTimerTree;
+
+/*
+ * Handle to a timer nested into another with `nest()`.
+ *
+ * Refers to the timer by its index in the tree of the root timer, so it stays
+ * valid while the root timer exists, and dereferences like a pointer.
+ */
+template<typename Clock> class BasicNestedTimer {
+ public:
+  using Index = std::uint32_t;
+
+  BasicNestedTimer() = default;
+  BasicNestedTimer(BasicTimerTree<Clock> *tree, const Index index)
+    : tree_(tree), index_(index) {}
+
+  BasicTimer<Clock> *operator->() const { return &(*tree_)[index_]; }
+  BasicTimer<Clock> &operator*() const { return (*tree_)[index_]; }
+  explicit operator bool() const { return tree_ != nullptr; }
+
+  [[nodiscard]] Index index() const { return index_; }
+
+ private:
+  BasicTimerTree<Clock> *tree_{nullptr};
+  Index index_{0};
+};
+
 /*
  * Timer class to perform runtime analytics.
  *
@@ -30,41 +77,245 @@ using Scalar = double;
  * output to arbitrary streams, overloading the stream operator,
  * or `print()` which always prints to console.
  *
+ * The clock is a policy, see clock.hpp, and `Timer` uses the
+ * `HighResolutionClock`. Pick a cheaper or more precise clock per call site,
+ * like `BasicTimer<TscClock>` for short kernels.
+ *
+ * Timers can be nested into others with `nest()` to print them as a tree.
+ * All nested timers of a root timer are stored in one arena owned by the root,
+ * see `BasicTimerTree`. Copying or moving a timer into a new one yields a root
+ * timer with the nested timers of the source; moving a root timer keeps the
+ * handles to its nested timers valid, they then refer to the new timer's.
+ * Assigning a timer copies its timings and those of its nested timers into
+ * the nested timers of the same name of the target, which are updated in
+ * place, so handles into the target stay valid. Nested timers missing in the
+ * target are added, and those missing in the source are reset. Moving copies
+ * the statistic, which may throw, so a growing `std::vector` copies its
+ * timers; keep timers with handles in a `std::deque` or reserve up front.
+ *
  */
-class Timer : public Statistic {
+template<typename Clock> class BasicTimer : public Statistic {
  public:
-  Timer(const std::string &name = "") : Statistic("Timer " + name) {}
-  Timer(const Timer &other) = default;
+  using Tree = BasicTimerTree<Clock>;
+  using Index = typename Tree::Index;
+
+  BasicTimer(const std::string &name = "") : Statistic("Timer " + name) {}
+
+  BasicTimer(const BasicTimer &other) : Statistic(other) {
+    copyFeatures(other);
+    copyNested(other);
+  }
+
+  /// Takes over the nested timers of a root timer, and copies those of a
+  /// nested timer, which are owned by its root. Also takes over the intervals.
+  BasicTimer(BasicTimer &&other)
+    : Statistic(other),
+      own_tree_(std::move(other.own_tree_)),
+      intervals_(other.intervals_.exchange(nullptr)) {
+    copyFeatures(other);
+    if (other.tree_) copyNested(other);
+  }
+
+  ~BasicTimer() { delete intervals_.load(); }
+
+  /// Copies the timings and nested timers into this timer and its nested
+  /// timers, but keeps the names, see the class description.
+  BasicTimer &operator=(const BasicTimer &other) {
+    if (this == &other) return *this;
+    // The nested timers of `other` may be in the tree being assigned to.
+    const Tree *const from = other.nestedTreeIfAny();
+    if (from && from == nestedTreeIfAny()) return *this = BasicTimer(other);
+    Statistic::operator=(other);
+    copyFeatures(other);
+    assignNested(other);
+    return *this;
+  }
+
+  /// Like copying, but takes over the nested timers of a root timer if this
+  /// is a root timer without nested timers, which no handle can refer to.
+  BasicTimer &operator=(BasicTimer &&other) {
+    if (this == &other) return *this;
+    if (tree_ || own_tree_ || other.tree_) return *this = other;
+    Statistic::operator=(other);
+    copyFeatures(other);
+    own_tree_ = std::move(other.own_tree_);
+    return *this;
+  }
 
   /// Start the timer.
-  void tic() { t_start_ = std::chrono::high_resolution_clock::now(); }
+  void tic() {
+    if (usage_) usage_->start();
+    if (perf_) perf_->start();
+    if (Tracer::active()) Tracer::begin(traceName());
+    t_start_ = Clock::now();
+  }
 
   /// Stops timer, calculates timing, also tics again.
   Scalar toc() {
-    // Calculate timing.
-    const TimePoint t_end = std::chrono::high_resolution_clock::now();
-    const Scalar dt =
-      1e-9 * (Scalar)std::chrono::duration_cast<std::chrono::nanoseconds>(
-               t_end - t_start_)
-               .count();
+    const Scalar dt = stop();
+    if (exemplars_) exemplars_->add(dt);
+    return this->add(dt);
+  }
 
-    t_start_ = t_end;
+  /// Stops timer like `toc()` and keeps the timing with `tag` if it is among
+  /// the slowest, see `enableExemplars()`.
+  Scalar toc(const Tag tag) {
+    if (!exemplars_) exemplars_.emplace();
+    const Scalar dt = stop();
+    exemplars_->add(dt, tag);
     return this->add(dt);
   }
 
+  /// Stops timer like `toc()` and pairs the timing with a quantity `x`, like a
+  /// payload size or queue depth, to track their covariance.
+  Scalar toc(const Scalar x) {
+    const Scalar dt = stop();
+    if (exemplars_) exemplars_->add(dt);
+    const Scalar mean = this->add(dt);
+    if (!paired_) paired_ = std::make_unique<CovarianceStatistic>("size");
+    // Only pair timings the statistic accepted.
+    if (std::isfinite(dt)) paired_->add(x, dt);
+    return mean;
+  }
+
+  /// Adds a timing in seconds, also to the intervals if enabled.
+  Scalar add(const Scalar dt) {
+    IntervalStatistic *const intervals =
+      intervals_.load(std::memory_order_acquire);
+    if (intervals) *intervals << dt;
+    return Statistic::add(dt);
+  }
+
+  /// Also adds all timings to an `IntervalStatistic` with a reservoir of
+  /// `capacity` samples, for per-interval reports from another thread, see
+  /// `Reporter`. Can be called from any thread while the timer runs, and
+  /// stays enabled for the lifetime of the timer. Intervals are not copied or
+  /// assigned, as readers refer to those of this timer.
+  IntervalStatistic &enableIntervals(const std::size_t capacity = 1024) {
+    IntervalStatistic *intervals = intervals_.load(std::memory_order_acquire);
+    if (intervals) return *intervals;
+    std::unique_ptr<IntervalStatistic> created =
+      std::make_unique<IntervalStatistic>(this->name());
+    created->enableReservoir(capacity);
+    if (intervals_.compare_exchange_strong(intervals, created.get(),
+                                           std::memory_order_acq_rel))
+      return *created.release();
+    return *intervals;
+  }
+
+  /// The intervals of the timings, if enabled.
+  [[nodiscard]] IntervalStatistic *intervals() const {
+    return intervals_.load(std::memory_order_acquire);
+  }
+
+  /// Names the quantity passed to `toc(x)`, used in reports.
+  void pair(const std::string &name) {
+    paired_ = std::make_unique<CovarianceStatistic>(name);
+  }
+
+  /// Keeps the `k` slowest timings with their tags, reported under the timer.
+  void enableExemplars(const std::size_t k = 5) { exemplars_.emplace(k); }
+
+  /// Breaks down timings into CPU and wait time, and counts context switches
+  /// and page faults, reported under the timer. Tic on the timing thread.
+  void enableUsage(const bool enable = true) {
+    if (enable)
+      usage_ = std::make_unique<UsageStatistic>();
+    else
+      usage_.reset();
+  }
+
+  /// CPU and wait time of the timings, if enabled.
+  [[nodiscard]] const UsageStatistic *usage() const {
+    return usage_.get();
+  }
+
+  /// Counts cycles, instructions, cache and branch misses per timing with
+  /// hardware counters, reported under the timer. Tic on the timing thread.
+  /// Returns false if the counters are unavailable, which records nothing.
+  bool enablePerfCounters(const bool enable = true) {
+    if (!enable) {
+      perf_.reset();
+      return false;
+    }
+    perf_ = std::make_unique<PerfStatistic>();
+    return PerfStatistic::available();
+  }
+
+  /// Hardware counters of the timings, if enabled.
+  [[nodiscard]] const PerfStatistic *perf() const {
+    return perf_.get();
+  }
+
+  /// Median timing of an empty section with this clock, measured once.
+  /// Timings below about 3x the overhead are flagged as unreliable.
+  static Scalar overhead() {
+    static const Scalar overhead = measureOverhead();
+    return overhead;
+  }
+
+  /// Measures the median timing of `samples` empty `tic()`, `toc()` pairs.
+  /// Chaining `toc()` calls without `tic()` also includes updating the
+  /// statistic, so the actual overhead may be slightly larger.
+  static Scalar measureOverhead(const int samples = 1001) {
+    BasicTimer timer;
+    std::vector<Scalar> timings((std::size_t)std::max(samples, 1));
+    for (Scalar &timing : timings) {
+      timer.tic();
+      timer.toc();
+      timing = timer.last();
+    }
+    const auto median = timings.begin() + (std::ptrdiff_t)timings.size() / 2;
+    std::nth_element(timings.begin(), median, timings.end());
+    return *median;
+  }
+
+  /// Subtracts the `overhead()` from all following timings.
+  void subtractOverhead(const bool enable = true) {
+    overhead_ = enable ? overhead() : 0.0;
+  }
+
+  /// The slowest timings, if enabled or tagged.
+  [[nodiscard]] const Exemplars *exemplars() const {
+    return exemplars_ ? &*exemplars_ : nullptr;
+  }
+
+  /// Covariance of timings with the quantity passed to `toc(x)`, if any.
+  [[nodiscard]] const CovarianceStatistic *paired() const {
+    return paired_.get();
+  }
+
   /// Reset saved timings and calls;
   void reset() {
     t_start_ = TimePoint();
-    Statistic::reset();
+    resetStatistics();
+  }
+
+  /// Returns the timings since the last snapshot and starts a fresh interval,
+  /// keeping a running `tic()`. Nested timers are not rotated.
+  BasicTimer snapshotAndRotate() {
+    BasicTimer snapshot(*this);
+    resetStatistics();
+    return snapshot;
   }
 
-  std::shared_ptr<Timer> nest(const std::string &nested_name) {
-    nested_timers_.emplace_back(std::make_shared<Timer>(nested_name));
-    return nested_timers_.back();
+  /// Creates a timer nested into this one, printed below it.
+  BasicNestedTimer<Clock> nest(const std::string &nested_name) {
+    Tree &tree = nestedTree();
+    return BasicNestedTimer<Clock>(&tree, tree.add(nestedIndex(), nested_name));
+  }
+
+  /// Calls `f` on each timer nested into this one, in order of nesting.
+  template<typename F> void forEachNested(F &&f) const {
+    const Tree *const tree = nestedTreeIfAny();
+    if (!tree) return;
+    for (Index i = tree->links(nestedIndex()).first_child; i != Tree::NONE;
+         i = tree->links(i).next_sibling)
+      f((*tree)[i]);
   }
 
   /// Custom stream operator for outputs.
-  friend std::ostream &operator<<(std::ostream &os, const Timer &timer) {
+  friend std::ostream &operator<<(std::ostream &os, const BasicTimer &timer) {
     os << timer.printNested();
     return os;
   }
@@ -73,18 +324,189 @@ class Timer : public Statistic {
   void print() const { std::cout << *this; }
 
  private:
-  [[nodiscard]] std::string printNested(const int level = 0,
-                                        const Scalar parent_sum = 0.0) const {
-    const int name_width = 30 - 2 * level;
+  friend class BasicTimerTree<Clock>;
+
+  /// Tag only this class can create, so the constructor below is internal.
+  class ShallowCopy {
+    friend class BasicTimer;
+    explicit ShallowCopy() = default;
+  };
+
+ public:
+  /// Copies the timings, but not the nested timers, used by the tree.
+  BasicTimer(const BasicTimer &other, ShallowCopy) : Statistic(other) {
+    copyFeatures(other);
+  }
+
+ private:
+
+  void copyFeatures(const BasicTimer &other) {
+    t_start_ = other.t_start_;
+    paired_ = other.paired_
+                ? std::make_unique<CovarianceStatistic>(*other.paired_)
+                : nullptr;
+    exemplars_ = other.exemplars_;
+    usage_ =
+      other.usage_ ? std::make_unique<UsageStatistic>(*other.usage_) : nullptr;
+    perf_ =
+      other.perf_ ? std::make_unique<PerfStatistic>(*other.perf_) : nullptr;
+    overhead_ = other.overhead_;
+    trace_name_ = 0;
+  }
+
+  /// The tree holding the timers nested into this one.
+  Tree &nestedTree() {
+    if (tree_) return *tree_;
+    if (!own_tree_) own_tree_ = std::make_unique<Tree>();
+    return *own_tree_;
+  }
+
+  /// Index of this timer in `nestedTree()`.
+  [[nodiscard]] Index nestedIndex() const {
+    return tree_ ? index_ : Tree::ROOT;
+  }
+
+  /// The tree holding the timers nested into this one, if any.
+  [[nodiscard]] const Tree *nestedTreeIfAny() const {
+    return tree_ ? tree_ : own_tree_.get();
+  }
+
+  /// Copies the timers nested into `other` below this root timer.
+  void copyNested(const BasicTimer &other) {
+    const Tree *const from = other.nestedTreeIfAny();
+    if (!from) return;
+    Tree &to = nestedTree();
+    std::vector<std::pair<Index, Index>> stack{
+      {other.nestedIndex(), Tree::ROOT}};
+    while (!stack.empty()) {
+      const auto [source, target] = stack.back();
+      stack.pop_back();
+      for (Index i = from->links(source).first_child; i != Tree::NONE;
+           i = from->links(i).next_sibling) {
+        stack.emplace_back(i, to.add(target, (*from)[i], ShallowCopy()));
+      }
+    }
+  }
+
+  /// Assigns the timers nested into `other` to those of the same name nested
+  /// into this timer, adding missing ones and resetting those not in `other`.
+  void assignNested(const BasicTimer &other) {
+    const Tree *const from = other.nestedTreeIfAny();
+    if (!from && !nestedTreeIfAny()) return;
+    Tree &to = nestedTree();
+    std::vector<std::pair<Index, Index>> stack;
+    std::vector<Index> unmatched;
+    if (from)
+      stack.emplace_back(other.nestedIndex(), nestedIndex());
+    else
+      unmatched.push_back(nestedIndex());
+
+    std::vector<Index> matched;
+    while (!stack.empty()) {
+      const auto [source, target] = stack.back();
+      stack.pop_back();
+      matched.clear();
+      for (Index i = from->links(source).first_child; i != Tree::NONE;
+           i = from->links(i).next_sibling) {
+        Index j = to.links(target).first_child;
+        while (j != Tree::NONE &&
+               (to[j].name() != (*from)[i].name() ||
+                std::find(matched.begin(), matched.end(), j) != matched.end()))
+          j = to.links(j).next_sibling;
+        if (j == Tree::NONE) {
+          j = to.add(target, (*from)[i], ShallowCopy());
+        } else {
+          to[j].Statistic::operator=((*from)[i]);
+          to[j].copyFeatures((*from)[i]);
+        }
+        matched.push_back(j);
+        stack.emplace_back(i, j);
+      }
+      for (Index j = to.links(target).first_child; j != Tree::NONE;
+           j = to.links(j).next_sibling)
+        if (std::find(matched.begin(), matched.end(), j) == matched.end()) {
+          to[j].reset();
+          unmatched.push_back(j);
+        }
+    }
+
+    // Resets the nested timers missing in `other`, with all below them.
+    while (!unmatched.empty()) {
+      const Index target = unmatched.back();
+      unmatched.pop_back();
+      for (Index j = to.links(target).first_child; j != Tree::NONE;
+           j = to.links(j).next_sibling) {
+        to[j].reset();
+        unmatched.push_back(j);
+      }
+    }
+  }
+
+  void resetStatistics() {
+    Statistic::reset();
+    if (paired_) paired_->reset();
+    if (exemplars_) exemplars_->reset();
+    if (usage_) usage_->reset();
+    if (perf_) perf_->reset();
+  }
+
+  /// Name of the timer in traces, interned on first use.
+  NameId traceName() {
+    if (!trace_name_) trace_name_ = NameTable::intern(this->name_);
+    return trace_name_;
+  }
+
+  /// Calculates the timing since the last tic and tics again.
+  Scalar stop() {
+    const TimePoint t_end = nowOrdered<Clock>();
+    const Scalar dt =
+      std::max(Clock::seconds(t_start_, t_end) - overhead_, 0.0);
+    t_start_ = t_end;
+    if (Tracer::active()) Tracer::end(traceName());
+    if (perf_) perf_->stop();
+    if (usage_) usage_->stop(dt);
+    return dt;
+  }
+
+  /// Renders this timer and all nested timers into one buffer.
+  [[nodiscard]] std::string printNested() const {
+    struct Entry {
+      const BasicTimer *timer;
+      int level;
+      Scalar parent_sum;
+    };
+
     std::ostringstream ss;
+    ss.precision(3);
+    std::vector<Entry> stack{{this, 0, 0.0}};
+    while (!stack.empty()) {
+      const Entry entry = stack.back();
+      stack.pop_back();
+      if (!entry.timer->printNode(ss, entry.level, entry.parent_sum)) continue;
+
+      const std::size_t first = stack.size();
+      entry.timer->forEachNested([&](const BasicTimer &nested) {
+        stack.push_back({&nested, entry.level + 1, entry.timer->sum_});
+      });
+      std::reverse(stack.begin() + (std::ptrdiff_t)first, stack.end());
+    }
+    return ss.str();
+  }
+
+  /// Prints the lines of this timer, returns false if it has no samples.
+  bool printNode(std::ostream &ss, const int level,
+                 const Scalar parent_sum) const {
+    const int name_width = 30 - 2 * level;
+    if (level > 0) {
+      for (int i = 1; i < level; ++i) ss << "| ";
+      ss << "|-";
+    }
     if (this->n_ < 1) {
       ss << std::left << std::setw(name_width) << this->name_
          << "has no sample yet." << std::endl;
-      return ss.str();
+      return false;
     }
 
-    ss.precision(3);
-
     ss << std::left << std::setw(name_width) << this->name_;
     ss << std::right << std::setw(8) << this->sum_ << "s  ";
     if (parent_sum != 0.0)
@@ -98,21 +520,156 @@ class Timer : public Statistic {
     ss << std::left << std::setw(8) << 1000 * this->std() << "  [min|max:  ";
     ss << std::right << std::setw(8) << 1000 * this->min_ << " | ";
     ss << std::left << std::setw(8) << 1000 * this->max_ << "]"
-       << " in ms\n";
+       << " in ms";
+    if (this->heavyTailed())
+      ss << "  heavy tail (kurtosis " << this->kurtosis() << ")";
+    const Scalar overhead =
+      overhead_ > 0.0 ? overhead_ : BasicTimer::overhead();
+    if (this->mean() < 3.0 * overhead)
+      ss << "  unreliable (overhead " << 1000 * overhead << " ms"
+         << (overhead_ > 0.0 ? " subtracted)" : ")");
+    else if (overhead_ > 0.0)
+      ss << "  overhead " << 1000 * overhead_ << " ms subtracted";
+    ss << '\n';
 
-    for (const std::shared_ptr<Timer> &nested : nested_timers_) {
+    if (paired_ && paired_->count() > 0) {
       for (int i = 0; i < level; ++i) ss << "| ";
-      ss << "|-" << nested->printNested(level + 1, this->sum_);
+      ss << "  vs " << paired_->name() << ":  corr " << paired_->correlation()
+         << "  slope " << 1000 * paired_->slope() << " ms/unit\n";
     }
-    return ss.str();
+
+    if (usage_ && usage_->count() > 0) {
+      const ThreadUsage &total = usage_->total();
+      const Scalar calls = usage_->count();
+      for (int i = 0; i < level; ++i) ss << "| ";
+      ss << "  cpu|wait: " << 1000 * usage_->cpu().mean() << " | "
+         << 1000 * usage_->wait().mean() << " in ms  switches vol|invol: "
+         << (Scalar)total.voluntary_switches / calls << " | "
+         << (Scalar)total.involuntary_switches / calls << "  faults min|maj: "
+         << (Scalar)total.minor_faults / calls << " | "
+         << (Scalar)total.major_faults / calls << " per call\n";
+    }
+
+    if (perf_ && perf_->count() > 0) {
+      for (int i = 0; i < level; ++i) ss << "| ";
+      ss << "  cycles: " << (*perf_)[PerfCounter::Cycles].mean()
+         << " per call  ipc " << perf_->ipc() << "  cache|branch mpki: "
+         << perf_->mpki(PerfCounter::CacheMisses) << " | "
+         << perf_->mpki(PerfCounter::BranchMisses) << '\n';
+    }
+
+    const Reservoir *const reservoir = this->reservoir();
+    if (reservoir && reservoir->size() > 0) {
+      for (int i = 0; i < level; ++i) ss << "| ";
+      ss << "  p50|p90|p99: " << 1000 * reservoir->quantile(0.5) << " | "
+         << 1000 * reservoir->quantile(0.9) << " | "
+         << 1000 * reservoir->quantile(0.99) << " in ms\n";
+    }
+
+    if (this->detector_ && !this->detector_->events().empty()) {
+      const ChangeEvent &change = this->detector_->events().back();
+      for (int i = 0; i < level; ++i) ss << "| ";
+      ss << "  level shift: " << 1000 * change.before << " -> "
+         << 1000 * change.after << " ms from call " << change.start << " ("
+         << this->detector_->events().size() << " shifts)\n";
+    }
+
+    if (exemplars_) {
+      for (const Exemplar &exemplar : exemplars_->sorted()) {
+        for (int i = 0; i < level; ++i) ss << "| ";
+        ss << "  slowest: ";
+        Exemplars::print(ss, exemplar, 1000.0);
+        ss << "  in ms\n";
+      }
+    }
+
+    return true;
   }
 
-  using TimePoint = std::chrono::high_resolution_clock::time_point;
-  TimePoint t_start_;
-  std::vector<std::shared_ptr<Timer>> nested_timers_;
+  using TimePoint = typename Clock::time_point;
+  TimePoint t_start_{};
+  /// Tree this timer is nested in, or null for root timers.
+  Tree *tree_{nullptr};
+  Index index_{0};
+  /// Tree of the timers nested into this root timer.
+  std::unique_ptr<Tree> own_tree_;
+  /// Owned, published atomically to enable it while the timer runs.
+  std::atomic<IntervalStatistic *> intervals_{nullptr};
+  /// Allocated on the first `toc(x)` or `pair()`.
+  std::unique_ptr<CovarianceStatistic> paired_;
+  std::optional<Exemplars> exemplars_;
+  /// Allocated when enabled, as they are large.
+  std::unique_ptr<UsageStatistic> usage_;
+  std::unique_ptr<PerfStatistic> perf_;
+  Scalar overhead_{0.0};
+  NameId trace_name_{0};
 };
 
-using NestedTimer = std::shared_ptr<Timer>;
+/*
+ * Arena of the timers nested into a root timer.
+ *
+ * Nested timers are stored in a deque, which never moves its elements, and
+ * link to their parent, first child and next sibling by index, so nesting
+ * allocates only once per block of timers and handles stay valid. The root
+ * timer itself is not stored, its links are at index `ROOT`.
+ */
+template<typename Clock> class BasicTimerTree {
+ public:
+  using Index = std::uint32_t;
+  static constexpr Index NONE = 0xffffffff;
+  static constexpr Index ROOT = 0;
+
+  struct Links {
+    Index parent;
+    Index first_child{NONE};
+    Index last_child{NONE};
+    Index next_sibling{NONE};
+  };
+
+  BasicTimerTree() {
+    timers_.emplace_back();
+    links_.push_back({NONE});
+  }
+  BasicTimerTree(const BasicTimerTree &) = delete;
+  BasicTimerTree &operator=(const BasicTimerTree &) = delete;
+
+  /// Adds a timer constructed from `args` below `parent`, returns its index.
+  template<typename... Args> Index add(const Index parent, Args &&...args) {
+    const Index index = (Index)links_.size();
+    timers_.emplace_back(std::forward<Args>(args)...);
+    timers_.back().tree_ = this;
+    timers_.back().index_ = index;
+    links_.push_back({parent});
+
+    Links &links = links_[parent];
+    if (links.last_child == NONE)
+      links.first_child = index;
+    else
+      links_[links.last_child].next_sibling = index;
+    links.last_child = index;
+    return index;
+  }
+
+  BasicTimer<Clock> &operator[](const Index i) { return timers_[i]; }
+  const BasicTimer<Clock> &operator[](const Index i) const {
+    return timers_[i];
+  }
+
+  [[nodiscard]] const Links &links(const Index i) const { return links_[i]; }
+
+  /// Number of nested timers.
+  [[nodiscard]] std::size_t size() const { return links_.size() - 1; }
+
+ private:
+  std::deque<BasicTimer<Clock>> timers_;
+  std::vector<Links> links_;
+};
+
+using Timer = BasicTimer<HighResolutionClock>;
+using NestedTimer = BasicNestedTimer<HighResolutionClock>;
+
+/// Timer using the CPU timestamp counter, see `TscClock`.
+using TscTimer = BasicTimer<TscClock>;
 
 /*
  * Helper Timer class to time scopes from Timer constructor to destructor.
@@ -120,15 +677,17 @@ using NestedTimer = std::shared_ptr<Timer>;
  * This effectively instantiates a timer and calls `tic()` in its constructor
  * and `toc()` and ` print()` in its destructor.
  */
-class ScopedTimer : public Timer {
+template<typename Clock> class BasicScopedTimer : public BasicTimer<Clock> {
  public:
-  ScopedTimer(const std::string &name = "") : Timer(name) { this->tic(); }
-  ScopedTimer(const std::string &name, Logger &&logger)
-    : Timer(name), logger(&logger) {
+  BasicScopedTimer(const std::string &name = "") : BasicTimer<Clock>(name) {
+    this->tic();
+  }
+  BasicScopedTimer(const std::string &name, Logger &&logger)
+    : BasicTimer<Clock>(name), logger(&logger) {
     this->tic();
   }
 
-  ~ScopedTimer() {
+  ~BasicScopedTimer() {
     this->toc();
     if (logger != nullptr)
       *logger << *this;
@@ -140,15 +699,186 @@ class ScopedTimer : public Timer {
   Logger *logger{nullptr};
 };
 
-class ScopedTicToc {
+using ScopedTimer = BasicScopedTimer<HighResolutionClock>;
+
+template<typename Clock> class BasicScopedTicToc {
+ public:
+  BasicScopedTicToc(BasicTimer<Clock> &timer) : timer(timer) { timer.tic(); }
+  ~BasicScopedTicToc() { timer.toc(); }
+
+ private:
+  BasicTimer<Clock> &timer;
+};
+
+using ScopedTicToc = BasicScopedTicToc<HighResolutionClock>;
+
+/*
+ * Timer accumulating integer clock ticks, converted to seconds when queried.
+ *
+ * `toc()` of a `Timer` converts each timing to seconds in floating point and
+ * adds it to a `Statistic`. This timer instead keeps the raw ticks between
+ * `tic()` and `toc()` in a `TickStatistic`, so each timing is two clock reads
+ * and a few integer operations, exact irrespective of the number of samples.
+ * All getters convert to seconds with the `period()` of the clock, which needs
+ * `ticks(from, to)` and `period()` in the clock policy, see clock.hpp. It
+ * prints like a `Timer`, but does not support nesting or any of the optional
+ * features of `Timer`.
+ */
+template<typename Clock> class BasicTickTimer {
  public:
-  ScopedTicToc(Timer &timer) : timer(timer) { timer.tic(); }
-  ~ScopedTicToc() { timer.toc(); }
+  BasicTickTimer(const std::string &name = "") : ticks_("Timer " + name) {}
+
+  /// Start the timer.
+  void tic() { t_start_ = Clock::now(); }
+
+  /// Stops timer, adds the ticks since the last tic, also tics again.
+  /// Returns the ticks of this timing, unlike `Timer::toc()`, so the hot path
+  /// never converts to seconds; the getters do.
+  std::uint64_t toc() {
+    const typename Clock::time_point t_end = nowOrdered<Clock>();
+    const std::uint64_t ticks = Clock::ticks(t_start_, t_end);
+    t_start_ = t_end;
+    ticks_.add(ticks);
+    return ticks;
+  }
+
+  /// Adds a timing in ticks of the clock.
+  void add(const std::uint64_t ticks) { ticks_.add(ticks); }
+
+  BasicTickTimer &merge(const BasicTickTimer &rhs) {
+    ticks_.merge(rhs.ticks_);
+    return *this;
+  }
+
+  /// The timings in ticks of the clock.
+  [[nodiscard]] const TickStatistic &ticks() const { return ticks_; }
+
+  [[nodiscard]] std::uint64_t count() const { return ticks_.count(); }
+  [[nodiscard]] Scalar sum() const { return seconds(ticks_.sum()); }
+  [[nodiscard]] Scalar mean() const { return Clock::period() * ticks_.mean(); }
+  [[nodiscard]] Scalar std() const { return Clock::period() * ticks_.std(); }
+  [[nodiscard]] Scalar last() const { return seconds(ticks_.last()); }
+  [[nodiscard]] Scalar min() const { return seconds(ticks_.min()); }
+  [[nodiscard]] Scalar max() const { return seconds(ticks_.max()); }
+
+  [[nodiscard]] const std::string &name() const { return ticks_.name(); }
+
+  /// Reset saved timings and calls.
+  void reset() {
+    t_start_ = typename Clock::time_point();
+    ticks_.reset();
+  }
+
+  /// Custom stream operator for outputs.
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const BasicTickTimer &timer) {
+    std::ostringstream ss;
+    ss.precision(3);
+    ss << std::left << std::setw(30) << timer.name();
+    if (timer.count() < 1) {
+      ss << "has no sample yet.\n";
+    } else {
+      ss << std::right << std::setw(8) << timer.sum() << "s       "
+         << std::setw(8) << timer.count() << "  calls   mean|std: "
+         << std::setw(8) << 1000 * timer.mean() << " | " << std::left
+         << std::setw(8) << 1000 * timer.std() << "  [min|max:  "
+         << std::right << std::setw(8) << 1000 * timer.min() << " | "
+         << std::left << std::setw(8) << 1000 * timer.max() << "] in ms\n";
+    }
+    os << ss.str();
+    return os;
+  }
+
+  /// Print timing information to console.
+  void print() const { std::cout << *this; }
 
  private:
-  Timer &timer;
+  static Scalar seconds(const std::uint64_t ticks) {
+    return Clock::period() * (Scalar)ticks;
+  }
+
+  TickStatistic ticks_;
+  typename Clock::time_point t_start_{};
 };
 
+using TickTimer = BasicTickTimer<HighResolutionClock>;
+
+/// Integer timer using the CPU timestamp counter, see `TscClock`.
+using TscTickTimer = BasicTickTimer<TscClock>;
+
+/*
+ * Timer aggregating the timings of a scope, which prints only now and then.
+ *
+ * A `ScopedTimer` in a loop prints on every iteration, flooding the output and
+ * costing microseconds each time. Instead, make this a static object at the
+ * call site, e.g. with `EFFORTLESS_AGGREGATE_SCOPE`, and time the scope with a
+ * `ScopedAggregate`, which costs two clock reads and one statistic update. The
+ * timer prints its statistics at destruction, i.e. at the end of the program,
+ * and optionally every `every_calls` timings and every `period` seconds, both
+ * checked at the end of a timing. Like any timer, it must only be timed from
+ * one thread at a time.
+ */
+template<typename Clock = HighResolutionClock>
+class BasicAggregateTimer : public BasicTimer<Clock> {
+ public:
+  using TimePoint = typename Clock::time_point;
+
+  BasicAggregateTimer(const std::string &name = "", const int every_calls = 0,
+                      const Scalar period = 0.0)
+    : BasicTimer<Clock>(name),
+      every_calls_(every_calls),
+      period_(period),
+      t_print_(Clock::now()) {}
+
+  ~BasicAggregateTimer() {
+    if (this->count() > printed_) this->print();
+  }
+
+  /// Adds the timing from `t_start` until now, printing if due.
+  void record(const TimePoint t_start) {
+    const TimePoint t_end = nowOrdered<Clock>();
+    this->add(Clock::seconds(t_start, t_end));
+    if (every_calls_ > 0 && this->count() % every_calls_ == 0) {
+      printNow(t_end);
+    } else if (period_ > 0.0 && Clock::seconds(t_print_, t_end) >= period_) {
+      printNow(t_end);
+    }
+  }
+
+ private:
+  void printNow(const TimePoint t_now) {
+    this->print();
+    printed_ = this->count();
+    t_print_ = t_now;
+  }
+
+  const int every_calls_;
+  const Scalar period_;
+  TimePoint t_print_;
+  int printed_{0};
+};
+
+using AggregateTimer = BasicAggregateTimer<HighResolutionClock>;
+
+/*
+ * Times a scope from construction to destruction into an aggregate timer.
+ */
+template<typename Clock> class BasicScopedAggregate {
+ public:
+  BasicScopedAggregate(BasicAggregateTimer<Clock> &timer)
+    : timer_(timer), t_start_(Clock::now()) {}
+  ~BasicScopedAggregate() { timer_.record(t_start_); }
+
+  BasicScopedAggregate(const BasicScopedAggregate &) = delete;
+  BasicScopedAggregate &operator=(const BasicScopedAggregate &) = delete;
+
+ private:
+  BasicAggregateTimer<Clock> &timer_;
+  const typename Clock::time_point t_start_;
+};
+
+using ScopedAggregate = BasicScopedAggregate<HighResolutionClock>;
+
 /*
  * Helper Timer class to instantiate a static Timer that prints in descructor.
  *
@@ -156,11 +886,173 @@ class ScopedTicToc {
  * tic-toc it. Once the program ends, the destructor of StaticTimer will print
  * its stats.
  */
-template<typename T = double> class StaticTimer : public Timer {
+template<typename Clock = HighResolutionClock>
+class BasicStaticTimer : public BasicTimer<Clock> {
+ public:
+  using BasicTimer<Clock>::BasicTimer;
+
+  ~BasicStaticTimer() { this->print(); }
+};
+
+/// Static timer with the high resolution clock, the parameter is unused.
+template<typename T = double>
+class StaticTimer : public BasicStaticTimer<HighResolutionClock> {
  public:
-  using Timer::Timer;
+  using BasicStaticTimer<HighResolutionClock>::BasicStaticTimer;
+};
+
+/*
+ * Static timer with one instance per thread, merged when printed.
+ *
+ * A single `StaticTimer` tic-toc'ed from several threads races. Create this as
+ * a static object instead, and each thread tic-toc's its own timer, created on
+ * its first use and pushed onto a lock-free list of this object. After that,
+ * `tic()` and `toc()` find the timer of the calling thread through a
+ * thread-local table, without any atomic operation or lock.
+ *
+ * `dump()` prints the timer of each thread, labelled in order of their first
+ * use, followed by their merged total. Unless constructed without
+ * `print_at_exit`, this is also done in the destructor at the end of the
+ * program. The timers of all
+ * threads are kept until then, also after their threads ended. Dump at a
+ * quiescent point, as timers of other threads are read without
+ * synchronization.
+ */
+template<typename Clock = HighResolutionClock> class ThreadStaticTimer {
+ public:
+  ThreadStaticTimer(const std::string &name = "",
+                    const bool print_at_exit = true)
+    : name_(name),
+      print_at_exit_(print_at_exit),
+      id_(ids().acquire()),
+      generation_(nextGeneration()) {}
+  ThreadStaticTimer(const ThreadStaticTimer &) = delete;
+  ThreadStaticTimer &operator=(const ThreadStaticTimer &) = delete;
+
+  ~ThreadStaticTimer() {
+    if (print_at_exit_ && head_.load(std::memory_order_acquire)) dump();
+    Local *local = head_.load(std::memory_order_acquire);
+    while (local) {
+      Local *const next = local->next;
+      delete local;
+      local = next;
+    }
+    ids().release(id_);
+  }
+
+  /// Starts the timer of the calling thread.
+  void tic() { local().tic(); }
+
+  /// Stops the timer of the calling thread, see `BasicTimer::toc()`.
+  Scalar toc() { return local().toc(); }
+
+  /// The timer of the calling thread, created on first use.
+  BasicTimer<Clock> &local() {
+    // Slots are reused by later timers, which the generation tells apart.
+    thread_local std::vector<Slot> slots;
+    if (id_ < slots.size() && slots[id_].generation == generation_)
+      return *slots[id_].timer;
+    if (id_ >= slots.size()) slots.resize(id_ + 1, Slot{0, nullptr});
+    slots[id_] = {generation_, &add()};
+    return *slots[id_].timer;
+  }
+
+  /// Calls `f` on the timer of each thread, in order of registration.
+  template<typename F> void forEachThread(F &&f) const {
+    std::vector<const Local *> locals;
+    for (const Local *local = head_.load(std::memory_order_acquire); local;
+         local = local->next)
+      locals.push_back(local);
+    for (auto it = locals.rbegin(); it != locals.rend(); ++it)
+      f((*it)->timer);
+  }
+
+  /// Merges the timers of all threads into one.
+  [[nodiscard]] BasicTimer<Clock> merged() const {
+    BasicTimer<Clock> total(name_ + " [all threads]");
+    forEachThread(
+      [&total](const BasicTimer<Clock> &timer) { total.merge(timer); });
+    return total;
+  }
+
+  /// Number of threads that used this timer.
+  [[nodiscard]] int threads() const {
+    return threads_.load(std::memory_order_acquire);
+  }
+
+  /// Prints the timer of each thread, labelled by its position in the list,
+  /// and their merged total.
+  void dump(std::ostream &os = std::cout) const {
+    int thread = 0;
+    forEachThread([&](const BasicTimer<Clock> &timer) {
+      BasicTimer<Clock> labelled(name_ + " [thread " +
+                                 std::to_string(thread++) + "]");
+      labelled.merge(timer);
+      os << labelled;
+    });
+    os << merged();
+  }
+
+ private:
+  struct Local {
+    BasicTimer<Clock> timer;
+    Local *next;
+  };
+
+  struct Slot {
+    std::uint64_t generation;
+    BasicTimer<Clock> *timer;
+  };
+
+  /// Ids of the live timers, indexing the thread-local tables, reused once
+  /// released, so the tables stay as small as the number of live timers.
+  struct Ids {
+    std::size_t acquire() {
+      const std::lock_guard<std::mutex> lock(mutex);
+      if (free.empty()) return next++;
+      const std::size_t id = free.back();
+      free.pop_back();
+      return id;
+    }
+
+    void release(const std::size_t id) {
+      const std::lock_guard<std::mutex> lock(mutex);
+      free.push_back(id);
+    }
+
+    std::mutex mutex;
+    std::vector<std::size_t> free;
+    std::size_t next{0};
+  };
+
+  BasicTimer<Clock> &add() {
+    Local *const local = new Local{BasicTimer<Clock>(name_),
+                                   head_.load(std::memory_order_relaxed)};
+    while (!head_.compare_exchange_weak(local->next, local,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+    }
+    threads_.fetch_add(1, std::memory_order_release);
+    return local->timer;
+  }
+
+  static Ids &ids() {
+    static Ids ids;
+    return ids;
+  }
+
+  /// Unique per timer, never reused, starting at 1 to mark empty slots.
+  static std::uint64_t nextGeneration() {
+    static std::atomic<std::uint64_t> generation{1};
+    return generation.fetch_add(1, std::memory_order_relaxed);
+  }
 
-  ~StaticTimer() { this->print(); }
+  const std::string name_;
+  const bool print_at_exit_;
+  const std::size_t id_;
+  const std::uint64_t generation_;
+  std::atomic<Local *> head_{nullptr};
+  std::atomic<int> threads_{0};
 };
 
 }  // namespace effortless
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "effortless/compact_statistic.hpp"
+#include "effortless/tsc_clock.hpp"
+
+namespace effortless {
+
+/// A begin or end event of a traced scope, 16 bytes.
+struct TraceEvent {
+  std::uint64_t time;
+  NameId name;
+  char phase;
+};
+
+/*
+ * Event buffer written by one thread and read by one other thread.
+ *
+ * Events are appended to fixed-size chunks that are linked into a list. The
+ * writer publishes each event with a release store of the chunk size, and
+ * only allocates when a chunk is full. The reader consumes all published
+ * events, following and freeing full chunks, without ever blocking the
+ * writer. Once the writer has `retire()`d the buffer, e.g. at thread exit, it
+ * is freed after the reader consumed the remaining events.
+ */
+class TraceBuffer {
+ public:
+  static constexpr std::uint32_t CHUNK_SIZE = 4096;
+
+  TraceBuffer(const int thread) : thread_(thread) {}
+  TraceBuffer(const TraceBuffer &) = delete;
+  ~TraceBuffer() {
+    while (head_) {
+      Chunk *const next = head_->next.load();
+      delete head_;
+      head_ = next;
+    }
+  }
+
+  /// Appends an event, only called from the writing thread.
+  void push(const TraceEvent &event) {
+    if (tail_size_ == CHUNK_SIZE) {
+      Chunk *const chunk = new Chunk;
+      tail_->next.store(chunk, std::memory_order_release);
+      tail_ = chunk;
+      tail_size_ = 0;
+    }
+    tail_->events[tail_size_] = event;
+    tail_->size.store(++tail_size_, std::memory_order_release);
+  }
+
+  /// Calls `f` on all events published since the last call, only called from
+  /// the reading thread.
+  template<typename F> void consume(F &&f) {
+    while (true) {
+      const std::uint32_t size = head_->size.load(std::memory_order_acquire);
+      for (; read_ < size; ++read_) f(head_->events[read_]);
+      if (size < CHUNK_SIZE) return;
+      Chunk *const next = head_->next.load(std::memory_order_acquire);
+      if (!next) return;
+      delete head_;
+      head_ = next;
+      read_ = 0;
+    }
+  }
+
+  /// Marks that no more events follow, only called from the writing thread.
+  void retire() { retired_.store(true, std::memory_order_release); }
+
+  /// True once retired, then `consume()` reads all remaining events.
+  [[nodiscard]] bool retired() const {
+    return retired_.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] int thread() const { return thread_; }
+
+ private:
+  struct Chunk {
+    std::array<TraceEvent, CHUNK_SIZE> events;
+    std::atomic<std::uint32_t> size{0};
+    std::atomic<Chunk *> next{nullptr};
+  };
+
+  const int thread_;
+  Chunk *head_{new Chunk};
+  std::uint32_t read_{0};
+  Chunk *tail_{head_};
+  std::uint32_t tail_size_{0};
+  std::atomic<bool> retired_{false};
+};
+
+/*
+ * Records timer scopes as Chrome Trace Events, e.g. to view in Perfetto.
+ *
+ * While started, every `tic()` and `toc()` of a `Timer`, and therefore every
+ * `ScopedTicToc`, records a begin and end event into a buffer of the calling
+ * thread, costing a timestamp read and a store. A background thread streams
+ * the events to the output as JSON, so the trace is never built in memory,
+ * and `stop()`, or the end of the program, completes the file. The output can
+ * be opened directly in https://ui.perfetto.dev or chrome://tracing.
+ *
+ * Traced timers must be tic-toc'ed in pairs, chained `toc()` calls produce
+ * end events without matching begin events. The buffer of a thread is freed
+ * once the thread exited and its events are written.
+ */
+class Tracer {
+ public:
+  ~Tracer() { close(); }
+
+  /// Starts tracing to a JSON file, flushing every `period` seconds.
+  static bool start(const std::string &path, const Scalar period = 0.1) {
+    Tracer &tracer = instance();
+    tracer.stop();
+    tracer.file_.open(path);
+    if (!tracer.file_) return false;
+    tracer.open(tracer.file_, period);
+    return true;
+  }
+
+  /// Starts tracing to a stream, which must outlive the trace.
+  static void start(std::ostream &os, const Scalar period = 0.1) {
+    Tracer &tracer = instance();
+    tracer.stop();
+    tracer.open(os, period);
+  }
+
+  /// Stops tracing, writes the remaining events and completes the output.
+  static void stop() { instance().close(); }
+
+  [[nodiscard]] static bool active() {
+    return active_.load(std::memory_order_relaxed);
+  }
+
+  /// Records the begin of a scope on the calling thread.
+  static void begin(const NameId name) {
+    buffer().push({TscClock::now(), name, 'B'});
+  }
+
+  /// Records the end of a scope on the calling thread.
+  static void end(const NameId name) {
+    buffer().push({TscClock::now(), name, 'E'});
+  }
+
+  /// Writes all recorded events, also done periodically in the background.
+  static void flush() { instance().write(); }
+
+  /// Number of threads with an event buffer, including exited threads whose
+  /// events are not written yet.
+  [[nodiscard]] static std::size_t threads() {
+    Tracer &tracer = instance();
+    const std::lock_guard<std::mutex> lock(tracer.buffers_mutex_);
+    return tracer.buffers_.size();
+  }
+
+ private:
+  Tracer() {
+    // Construct the name table first, so it is destroyed after the final
+    // write at exit.
+    NameTable::size();
+    TscClock::calibrate();
+  }
+
+  static Tracer &instance() {
+    static Tracer tracer;
+    return tracer;
+  }
+
+  /// The buffer of a thread, registered on first use and retired at exit.
+  struct Registration {
+    TraceBuffer *const buffer{instance().add()};
+    ~Registration() { instance().retire(buffer); }
+  };
+
+  static TraceBuffer &buffer() {
+    thread_local const Registration registration;
+    return *registration.buffer;
+  }
+
+  TraceBuffer *add() {
+    const std::lock_guard<std::mutex> lock(buffers_mutex_);
+    buffers_.push_back(std::make_unique<TraceBuffer>(next_thread_++));
+    return buffers_.back().get();
+  }
+
+  void retire(TraceBuffer *const buffer) {
+    const std::lock_guard<std::mutex> write_lock(write_mutex_);
+    // While tracing, the next write frees the buffer after its last events.
+    if (os_) {
+      buffer->retire();
+      return;
+    }
+
+    // Otherwise, its events would be dropped anyway.
+    const std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+      if (it->get() != buffer) continue;
+      buffers_.erase(it);
+      return;
+    }
+  }
+
+  void open(std::ostream &os, const Scalar period) {
+    {
+      const std::lock_guard<std::mutex> lock(write_mutex_);
+      // Drop events recorded after a previous trace was stopped.
+      forEachBuffer([](TraceBuffer &buffer) {
+        buffer.consume([](const TraceEvent &) {});
+      });
+      os_ = &os;
+      first_ = true;
+      t_start_ = TscClock::now();
+      *os_ << "{\"traceEvents\":[\n";
+    }
+    active_.store(true);
+
+    const std::lock_guard<std::mutex> lock(thread_mutex_);
+    running_ = true;
+    const std::chrono::nanoseconds wait((long long)(1e9 * period));
+    thread_ = std::thread([this, wait]() {
+      std::unique_lock<std::mutex> lock(thread_mutex_);
+      while (!wakeup_.wait_for(lock, wait, [this]() { return !running_; }))
+        write();
+    });
+  }
+
+  void close() {
+    {
+      const std::lock_guard<std::mutex> lock(thread_mutex_);
+      running_ = false;
+    }
+    wakeup_.notify_all();
+    if (thread_.joinable()) thread_.join();
+
+    if (!active_.exchange(false)) return;
+    write();
+    const std::lock_guard<std::mutex> lock(write_mutex_);
+    *os_ << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    os_->flush();
+    os_ = nullptr;
+    if (file_.is_open()) file_.close();
+  }
+
+  void write() {
+    const std::lock_guard<std::mutex> lock(write_mutex_);
+    if (!os_) return;
+    const Scalar us = 1e6 * TscClock::period();
+    const int pid = (int)getpid();
+    forEachBuffer([&](TraceBuffer &buffer) {
+      buffer.consume([&](const TraceEvent &event) {
+        if (event.time < t_start_) return;
+        char line[64];
+        std::snprintf(line, sizeof(line), "\",\"ph\":\"%c\",\"ts\":%.3f",
+                      event.phase, us * (Scalar)(event.time - t_start_));
+        *os_ << (first_ ? "{\"name\":\"" : ",\n{\"name\":\"");
+        escape(name(event.name));
+        *os_ << line << ",\"pid\":" << pid << ",\"tid\":" << buffer.thread()
+             << '}';
+        first_ = false;
+      });
+    });
+    os_->flush();
+  }
+
+  /// Calls `f` to consume each buffer, and frees the retired ones after.
+  template<typename F> void forEachBuffer(F &&f) {
+    const std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (auto it = buffers_.begin(); it != buffers_.end();) {
+      // Checked before consuming, so no event can follow.
+      const bool retired = (*it)->retired();
+      f(**it);
+      it = retired ? buffers_.erase(it) : it + 1;
+    }
+  }
+
+  /// Names are cached, so writing does not lock the name table per event.
+  const std::string &name(const NameId id) {
+    if (id >= names_.size()) names_.resize(id + 1, nullptr);
+    if (!names_[id]) names_[id] = &NameTable::name(id);
+    return *names_[id];
+  }
+
+  void escape(const std::string &s) {
+    for (const char c : s) {
+      if (c == '"' || c == '\\')
+        *os_ << '\\' << c;
+      else if ((unsigned char)c < 0x20)
+        *os_ << ' ';
+      else
+        *os_ << c;
+    }
+  }
+
+  static inline std::atomic<bool> active_{false};
+
+  std::mutex buffers_mutex_;
+  std::vector<std::unique_ptr<TraceBuffer>> buffers_;
+  int next_thread_{0};
+
+  std::mutex write_mutex_;
+  std::ofstream file_;
+  std::ostream *os_{nullptr};
+  bool first_{true};
+  std::uint64_t t_start_{0};
+  std::vector<const std::string *> names_;
+
+  std::thread thread_;
+  std::mutex thread_mutex_;
+  std::condition_variable wakeup_;
+  bool running_{false};
+};
+
+}  // namespace effortless
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace effortless {
+
+using Scalar = double;
+
+/*
+ * Clock reading the CPU timestamp counter.
+ *
+ * Reading the counter with `rdtsc`, or `cntvct_el0` on ARM, costs a few ns
+ * instead of the ~20 ns of `std::chrono` clocks, which matters when timing
+ * short kernels. Timestamps are raw ticks, converted to seconds with a single
+ * multiply by the calibrated `period()`, ideally only when reporting.
+ *
+ * The counter is only used if it is invariant, i.e. runs at a constant rate
+ * across frequency scaling and sleep states, as reported by cpuid, the kernel
+ * flags in /proc/cpuinfo, or the kernel using it as clock source. Its
+ * frequency is calibrated once against `std::chrono::steady_clock` on first
+ * use, or when calling `calibrate()` ahead of time. If the counter is
+ * unreliable, the clock falls back to `steady_clock` in ns.
+ */
+class TscClock {
+ public:
+  using time_point = std::uint64_t;
+
+  struct Calibration {
+    /// True if the timestamp counter is used, false for the fallback.
+    bool tsc;
+    /// Seconds per tick.
+    Scalar period;
+    /// Ticks per second.
+    Scalar frequency;
+  };
+
+  /// Current timestamp in ticks.
+  static std::uint64_t now() {
+    return calibration().tsc ? read() : fallback();
+  }
+
+  /// Current timestamp in ticks, read after all previous instructions have
+  /// completed, e.g. to stop a measurement.
+  static std::uint64_t nowOrdered() {
+    return calibration().tsc ? readOrdered() : fallback();
+  }
+
+  /// Converts a tick difference to seconds.
+  static Scalar seconds(const std::uint64_t ticks) {
+    return (Scalar)ticks * calibration().period;
+  }
+
+  /// Seconds between two timestamps.
+  static Scalar seconds(const time_point from, const time_point to) {
+    return seconds(to - from);
+  }
+
+  /// Ticks between two timestamps, zero if out of order.
+  static std::uint64_t ticks(const time_point from, const time_point to) {
+    return to > from ? to - from : 0;
+  }
+
+  [[nodiscard]] static Scalar period() { return calibration().period; }
+  [[nodiscard]] static Scalar frequency() { return calibration().frequency; }
+  [[nodiscard]] static bool usesTsc() { return calibration().tsc; }
+
+  /// Calibrates the clock, done once, taking about 20 ms.
+  static const Calibration &calibrate() { return calibration(); }
+
+  /// True if the timestamp counter runs at a constant rate.
+  static bool invariant() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8)))
+      return true;
+    // Hypervisors may hide the cpuid bit, but the kernel knows better.
+    return (cpuinfoHas("constant_tsc") && cpuinfoHas("nonstop_tsc")) ||
+           kernelClocksource() == "tsc";
+#elif defined(__aarch64__)
+    // The generic timer of ARMv8 runs at a fixed frequency.
+    return true;
+#else
+    return false;
+#endif
+  }
+
+ private:
+  static const Calibration &calibration() {
+    static const Calibration calibration = measure();
+    return calibration;
+  }
+
+  static Calibration measure() {
+    const Calibration steady{false, 1e-9, 1e9};
+    if (!invariant()) return steady;
+
+#if defined(__aarch64__)
+    std::uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    if (frequency > 0)
+      return {true, 1.0 / (Scalar)frequency, (Scalar)frequency};
+#endif
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point t_start = Clock::now();
+    const std::uint64_t tsc_start = readOrdered();
+    Clock::time_point t_end = t_start;
+    while (t_end - t_start < std::chrono::milliseconds(20))
+      t_end = Clock::now();
+    const std::uint64_t tsc_end = readOrdered();
+
+    const Scalar seconds =
+      1e-9 * (Scalar)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               t_end - t_start)
+               .count();
+    const Scalar frequency = (Scalar)(tsc_end - tsc_start) / seconds;
+    // Anything outside 1 MHz to 100 GHz indicates a broken counter.
+    if (!(frequency > 1e6 && frequency < 1e11)) return steady;
+    return {true, 1.0 / frequency, frequency};
+  }
+
+  static std::uint64_t read() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return fallback();
+#endif
+  }
+
+  static std::uint64_t readOrdered() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned aux;
+    return __rdtscp(&aux);
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(ticks)::"memory");
+    return ticks;
+#else
+    return fallback();
+#endif
+  }
+
+  static std::uint64_t fallback() {
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+  }
+
+  static bool cpuinfoHas(const std::string &flag) {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string word;
+    while (cpuinfo >> word)
+      if (word == flag) return true;
+    return false;
+  }
+
+  static std::string kernelClocksource() {
+    std::ifstream file(
+      "/sys/devices/system/clocksource/clocksource0/current_clocksource");
+    std::string clocksource;
+    file >> clocksource;
+    return clocksource;
+  }
+};
+
+}  // namespace effortless
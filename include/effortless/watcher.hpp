@@ -0,0 +1,303 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "effortless/interval_statistic.hpp"
+#include "effortless/logger.hpp"
+#include "effortless/statistic.hpp"
+#include "effortless/timer.hpp"
+
+namespace effortless {
+
+/*
+ * Registry of thresholds on statistics, evaluated off the hot path.
+ *
+ * Each watch reads a metric, like the mean or the p99 of a `Statistic` or
+ * `Timer`, and raises an alert when it crosses its `raise` threshold. With
+ * hysteresis, the alert clears only once the metric crosses back over the
+ * `clear` threshold. If `raise >= clear` the watch alerts on high values,
+ * otherwise on low values. Alerts are passed to a callback, or logged as
+ * warnings if none is given.
+ *
+ * Watches are evaluated by `evaluate()`, either called manually or from a
+ * background thread started with `start(rate)`. Adding samples to the watched
+ * statistics is unchanged and costs nothing extra.
+ *
+ * A `Statistic` is not synchronized, and reading it while another thread
+ * adds samples is a data race. Watches on them are therefore only evaluated by
+ * `evaluate()`, which must be called on the thread writing them, and never by
+ * the background thread. Watching an `IntervalStatistic` is thread-safe and
+ * evaluates the metric over the samples since the last evaluation, also in
+ * the background. Watching a `Timer` watches its intervals, see
+ * `BasicTimer::enableIntervals()`. Each evaluation takes one snapshot per
+ * interval statistic, shared by all its watches, as a consumer of its own, so
+ * other readers like a `Reporter` still see every sample. Custom metrics are
+ * evaluated in both, so they must be safe to call from the background thread
+ * if it is started.
+ */
+class Watcher {
+ public:
+  enum class Stat { Mean, Std, Min, Max, Last, Count, P50, P90, P99 };
+
+  struct Alert {
+    std::string name;
+    Scalar value;
+    Scalar threshold;
+    bool raised;
+  };
+
+  using Metric = std::function<Scalar()>;
+  using Callback = std::function<void(const Alert &)>;
+
+  Watcher(const std::string &name = "Watcher") : logger_(name) {}
+  Watcher(const Watcher &) = delete;
+  ~Watcher() {
+    stop();
+    for (Source &source : sources_)
+      source.statistic->unsubscribe(source.consumer);
+  }
+
+  /// Watches an arbitrary metric, returns an id to `unwatch()` it.
+  std::size_t watch(const std::string &name, Metric metric, const Scalar raise,
+                    const Scalar clear, Callback callback = Callback()) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    watches_.push_back({++last_id_, name, std::move(metric), raise, clear,
+                        std::move(callback), false});
+    return last_id_;
+  }
+
+  /// Watches `stat` of a statistic, which must outlive the watch. Only
+  /// evaluated by `evaluate()` on the thread writing the statistic.
+  /// Percentiles require a reservoir.
+  std::size_t watch(const Statistic &statistic, const Stat stat,
+                    const Scalar raise, const Scalar clear,
+                    Callback callback = Callback()) {
+    if (percentile(stat) && !statistic.reservoir())
+      throw std::invalid_argument("Watcher: percentile of '" +
+                                  statistic.name() + "' without reservoir");
+    const std::size_t id = watch(
+      statistic.name(), [&statistic, stat]() { return value(statistic, stat); },
+      raise, clear, std::move(callback));
+    const std::lock_guard<std::mutex> lock(mutex_);
+    watches_.back().live = true;
+    return id;
+  }
+
+  /// Watches `stat` of each interval of a statistic, which must outlive the
+  /// watch. Each evaluation covers the samples since the last one.
+  /// Percentiles require a reservoir.
+  std::size_t watch(IntervalStatistic &statistic, const Stat stat,
+                    const Scalar raise, const Scalar clear,
+                    Callback callback = Callback()) {
+    if (percentile(stat) && !statistic.sampled())
+      throw std::invalid_argument("Watcher: percentile of '" +
+                                  statistic.name() + "' without reservoir");
+    const std::lock_guard<std::mutex> lock(mutex_);
+    Source *source = nullptr;
+    for (Source &candidate : sources_)
+      if (candidate.statistic == &statistic) source = &candidate;
+    if (!source) {
+      sources_.push_back({&statistic, statistic.subscribe(),
+                          Statistic(statistic.name()), 0});
+      source = &sources_.back();
+    }
+    ++source->watches;
+
+    watches_.push_back(
+      {++last_id_, statistic.name(),
+       [source, stat]() { return value(source->interval, stat); }, raise,
+       clear, std::move(callback), false, false, source});
+    return last_id_;
+  }
+
+  /// Watches `stat` of each interval of a timer, which must outlive the
+  /// watch, in seconds. Enables the intervals of the timer, from its next
+  /// timing, which include a reservoir for percentiles.
+  template<typename Clock>
+  std::size_t watch(BasicTimer<Clock> &timer, const Stat stat,
+                    const Scalar raise, const Scalar clear,
+                    Callback callback = Callback()) {
+    return watch(timer.enableIntervals(), stat, raise, clear,
+                 std::move(callback));
+  }
+
+  /// Removes a watch, returns false if it does not exist.
+  bool unwatch(const std::size_t id) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = watches_.begin(); it != watches_.end(); ++it) {
+      if (it->id != id) continue;
+      if (it->source && --it->source->watches < 1) release(it->source);
+      watches_.erase(it);
+      return true;
+    }
+    return false;
+  }
+
+  /// Evaluates all watches once and fires alerts on state changes. Call on
+  /// the thread writing the watched statistics and timers.
+  /// Callbacks are called with the registry locked and must not (un)watch.
+  void evaluate() { evaluate(true); }
+
+  /// Starts evaluating in a background thread at `rate` Hz, which skips
+  /// watches on statistics and timers, see `evaluate()`.
+  void start(const Scalar rate = 10.0) {
+    stop();
+    {
+      const std::lock_guard<std::mutex> lock(thread_mutex_);
+      running_ = true;
+    }
+    const std::chrono::nanoseconds period((long long)(1e9 / rate));
+    thread_ = std::thread([this, period]() {
+      std::unique_lock<std::mutex> lock(thread_mutex_);
+      std::chrono::steady_clock::time_point t_next =
+        std::chrono::steady_clock::now();
+      while (running_) {
+        t_next += period;
+        if (wakeup_.wait_until(lock, t_next, [this]() { return !running_; }))
+          break;
+        evaluate(false);
+      }
+    });
+  }
+
+  /// Stops the background thread, if running.
+  void stop() {
+    {
+      const std::lock_guard<std::mutex> lock(thread_mutex_);
+      running_ = false;
+    }
+    wakeup_.notify_all();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  [[nodiscard]] bool raised(const std::size_t id) const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    for (const Watch &watch : watches_)
+      if (watch.id == id) return watch.raised;
+    return false;
+  }
+
+  /// Reads `stat` from a statistic, percentiles require a reservoir.
+  static Scalar value(const Statistic &statistic, const Stat stat) {
+    if (statistic.count() < 1) return std::numeric_limits<Scalar>::quiet_NaN();
+    switch (stat) {
+      case Stat::Std:
+        return statistic.std();
+      case Stat::Min:
+        return statistic.min();
+      case Stat::Max:
+        return statistic.max();
+      case Stat::Last:
+        return statistic.last();
+      case Stat::Count:
+        return (Scalar)statistic.count();
+      case Stat::P50:
+        return quantile(statistic, 0.5);
+      case Stat::P90:
+        return quantile(statistic, 0.9);
+      case Stat::P99:
+        return quantile(statistic, 0.99);
+      default:
+        return statistic.mean();
+    }
+  }
+
+ private:
+  static bool percentile(const Stat stat) {
+    return stat == Stat::P50 || stat == Stat::P90 || stat == Stat::P99;
+  }
+
+  /// An interval statistic with its snapshot of the current evaluation.
+  struct Source {
+    IntervalStatistic *statistic;
+    IntervalStatistic::Consumer consumer;
+    Statistic interval;
+    int watches;
+  };
+
+  struct Watch {
+    std::size_t id;
+    std::string name;
+    Metric metric;
+    Scalar raise;
+    Scalar clear;
+    Callback callback;
+    bool raised;
+    /// Reads a live statistic, only on the writing thread.
+    bool live{false};
+    /// The interval statistic read by the metric, if any.
+    Source *source{nullptr};
+  };
+
+  void evaluate(const bool live) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    for (Source &source : sources_)
+      source.interval =
+        source.statistic->snapshotAndRotate(source.consumer).statistic;
+
+    for (Watch &watch : watches_) {
+      if (watch.live && !live) continue;
+      const Scalar value = watch.metric();
+      if (!std::isfinite(value)) continue;
+
+      const bool high = watch.raise >= watch.clear;
+      const bool raise = high ? value > watch.raise : value < watch.raise;
+      const bool clear = high ? value < watch.clear : value > watch.clear;
+      if (!watch.raised && raise)
+        fire(watch, {watch.name, value, watch.raise, true});
+      else if (watch.raised && clear)
+        fire(watch, {watch.name, value, watch.clear, false});
+    }
+  }
+
+  void release(Source *source) {
+    source->statistic->unsubscribe(source->consumer);
+    for (auto it = sources_.begin(); it != sources_.end(); ++it) {
+      if (&*it != source) continue;
+      sources_.erase(it);
+      return;
+    }
+  }
+
+  static Scalar quantile(const Statistic &statistic, const Scalar p) {
+    return statistic.reservoir() ? statistic.reservoir()->quantile(p)
+                                 : std::numeric_limits<Scalar>::quiet_NaN();
+  }
+
+  void fire(Watch &watch, const Alert &alert) {
+    watch.raised = alert.raised;
+    if (watch.callback) {
+      watch.callback(alert);
+    } else if (alert.raised) {
+      logger_.warn("%s at %.3g beyond %.3g", alert.name.c_str(), alert.value,
+                   alert.threshold);
+    } else {
+      logger_.info("%s back at %.3g", alert.name.c_str(), alert.value);
+    }
+  }
+
+  Logger logger_;
+  mutable std::mutex mutex_;
+  std::vector<Watch> watches_;
+  std::list<Source> sources_;
+  std::size_t last_id_{0};
+
+  std::thread thread_;
+  std::mutex thread_mutex_;
+  std::condition_variable wakeup_;
+  bool running_{false};
+};
+
+}  // namespace effortless